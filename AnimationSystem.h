@@ -0,0 +1,174 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "ModelCache.h"
+
+// Plays node animations for any number of model instances. Every instance's
+// nodes live in one set of flat arrays (local, world, parent index), parents
+// before children, so world matrices of all instances come out of a single
+// forward pass with no per-node objects. Keyframe cursors are kept per
+// channel, so sampling advances instead of searching.
+//
+// An instance binds to its model once the model is ready; until then (and
+// for models without animated nodes) nodeMatrices() is null and the model
+// draws in its bind pose. Context thread only, like ModelCache.
+class AnimationSystem {
+public:
+    // Returns the instance id; `clip` indexes Model::getClips()
+    int add(const ModelHandle& model, size_t clip = 0, float speed = 1.0f) {
+        Instance inst;
+        inst.model = model;
+        inst.clip = clip;
+        inst.speed = speed;
+        if (!freeIds.empty()) {
+            const int id = freeIds.back();
+            freeIds.pop_back();
+            instances[size_t(id)] = std::move(inst);
+            return id;
+        }
+        instances.push_back(std::move(inst));
+        return int(instances.size()) - 1;
+    }
+
+    void remove(int id) {
+        if (id < 0 || size_t(id) >= instances.size() || !instances[size_t(id)].model)
+            return;
+        Instance& inst = instances[size_t(id)];
+        if (inst.nodeCount)
+            compactPending = true;
+        inst = Instance();
+        freeIds.push_back(id);
+    }
+
+    // Advances every instance by `dt` seconds and recomputes world matrices
+    void update(float dt) {
+        if (compactPending)
+            compact();
+        for (Instance& inst : instances) {
+            if (!inst.model)
+                continue;
+            if (!inst.bound && !bind(inst))
+                continue;
+            const auto& clips = inst.model->getClips();
+            if (inst.clip >= clips.size())
+                continue;
+            const AnimationClip& clip = clips[inst.clip];
+            inst.time += dt * inst.speed;
+            if (clip.duration > 0.0f) {
+                inst.time = std::fmod(inst.time, clip.duration);
+                if (inst.time < 0.0f)
+                    inst.time += clip.duration;
+            }
+            for (size_t c = 0; c < clip.channels.size(); ++c) {
+                const AnimationChannel& ch = clip.channels[c];
+                const uint32_t n = inst.firstNode + uint32_t(ch.node);
+                local[n] = offset[n] * sampleChannel(clip, ch, inst.time, cursors[inst.firstCursor + c]);
+            }
+        }
+        for (size_t i = 0; i < world.size(); ++i)
+            world[i] = parent[i] < 0 ? local[i] : world[size_t(parent[i])] * local[i];
+    }
+
+    // Model-space matrix per node of the instance's model (for Model::Draw),
+    // or null while it is not bound
+    const glm::mat4* nodeMatrices(int id) const {
+        if (id < 0 || size_t(id) >= instances.size())
+            return nullptr;
+        const Instance& inst = instances[size_t(id)];
+        return inst.bound && inst.nodeCount ? &world[inst.firstNode] : nullptr;
+    }
+
+    void setSpeed(int id, float speed) {
+        if (id >= 0 && size_t(id) < instances.size())
+            instances[size_t(id)].speed = speed;
+    }
+
+    size_t instanceCount() const { return instances.size() - freeIds.size(); }
+    size_t nodeCount()     const { return world.size(); }
+
+    void clear() {
+        instances.clear();
+        freeIds.clear();
+        local.clear();
+        offset.clear();
+        world.clear();
+        parent.clear();
+        cursors.clear();
+        compactPending = false;
+    }
+
+private:
+    struct Instance {
+        ModelHandle model;
+        size_t      clip = 0;
+        float       speed = 1.0f;
+        float       time = 0.0f;
+        bool        bound = false;
+        uint32_t    firstNode = 0, nodeCount = 0;
+        uint32_t    firstCursor = 0, cursorCount = 0;
+    };
+
+    // Appends the model's nodes in their bind pose
+    bool bind(Instance& inst) {
+        if (!inst.model->isReady() && !inst.model->hasFailed())
+            return false;
+        const auto& nodes = inst.model->getNodes();
+        const auto& clips = inst.model->getClips();
+        inst.firstNode = uint32_t(world.size());
+        inst.nodeCount = uint32_t(nodes.size());
+        for (const NodeData& n : nodes) {
+            local.push_back(n.offset * n.local);
+            offset.push_back(n.offset);
+            world.push_back(local.back());
+            parent.push_back(n.parent < 0 ? -1 : int32_t(inst.firstNode) + n.parent);
+        }
+        inst.firstCursor = uint32_t(cursors.size());
+        inst.cursorCount = inst.clip < clips.size() ? uint32_t(clips[inst.clip].channels.size()) : 0;
+        cursors.resize(cursors.size() + inst.cursorCount);
+        inst.bound = true;
+        return true;
+    }
+
+    // Drops the nodes of removed instances, keeping the rest in order
+    void compact() {
+        std::vector<glm::mat4> newLocal, newOffset;
+        std::vector<int32_t> newParent;
+        std::vector<KeyCursor> newCursors;
+        for (Instance& inst : instances) {
+            if (!inst.bound)
+                continue;
+            const uint32_t first = uint32_t(newLocal.size());
+            for (uint32_t i = 0; i < inst.nodeCount; ++i) {
+                const size_t n = inst.firstNode + i;
+                newLocal.push_back(local[n]);
+                newOffset.push_back(offset[n]);
+                newParent.push_back(parent[n] < 0 ? -1 : parent[n] - int32_t(inst.firstNode) + int32_t(first));
+            }
+            inst.firstNode = first;
+            const uint32_t firstCursor = uint32_t(newCursors.size());
+            newCursors.insert(newCursors.end(), cursors.begin() + inst.firstCursor,
+                cursors.begin() + inst.firstCursor + inst.cursorCount);
+            inst.firstCursor = firstCursor;
+        }
+        local = std::move(newLocal);
+        offset = std::move(newOffset);
+        parent = std::move(newParent);
+        cursors = std::move(newCursors);
+        world = local;
+        compactPending = false;
+    }
+
+    std::vector<Instance>  instances;   // indexed by id; freed slots are reused
+    std::vector<int>       freeIds;
+    std::vector<glm::mat4> local;       // per node, relative to the parent node
+    std::vector<glm::mat4> offset;      // baked static path to the parent node
+    std::vector<glm::mat4> world;       // per node, model space
+    std::vector<int32_t>   parent;      // index into the same arrays, -1: model
+    std::vector<KeyCursor> cursors;     // per bound channel
+    bool                   compactPending = false;
+};
@@ -0,0 +1,274 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "LzBlock.h"
+#include "MappedFile.h"
+
+// Single-file archive of loose assets (sources and assetc outputs), mapped
+// once so a load is a table lookup instead of an open/read per file.
+//
+//   PackHeader | entry data (each 4K-aligned) | PackEntry[entryCount] | names
+//
+// The table of contents sits at the end, sorted by the FNV-1a hash of the
+// entry's key (its '/'-separated path relative to the working directory), so
+// find() is a binary search over the mapping. Entries are stored raw or as
+// one LzBlock; stored entries are handed out as zero-copy views.
+class AssetPack {
+public:
+    static constexpr uint32_t kMagic     = 0x50574D4D; // "MMWP"
+    static constexpr uint32_t kVersion   = 1;
+    static constexpr size_t   kAlignment = 4096;
+
+    enum Codec : uint32_t { Stored = 0, Lz = 1 };
+
+    struct PackHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t entryCount;
+        uint32_t reserved;
+        uint64_t tocOffset;
+        uint64_t namesOffset;
+        uint64_t namesSize;
+    };
+
+    struct PackEntry {
+        uint64_t hash;
+        uint64_t offset;
+        uint64_t storedSize;
+        uint64_t size;
+        uint32_t codec;
+        uint32_t nameLength;
+        uint64_t nameOffset;   // into the names block; resolves hash collisions
+    };
+
+    // Input to write(): `data` is already encoded with `codec`
+    struct Input {
+        std::string                key;
+        std::vector<unsigned char> data;
+        uint64_t                   size = 0;
+        Codec                      codec = Stored;
+    };
+
+    // Path relative to the working directory, '/'-separated
+    static std::string keyFor(const std::string& path) {
+        std::filesystem::path p = std::filesystem::path(path).lexically_normal();
+        if (p.is_absolute()) {
+            std::error_code ec;
+            p = p.lexically_relative(std::filesystem::current_path(ec));
+        }
+        return p.generic_string();
+    }
+
+    static uint64_t hashKey(const std::string& key) {
+        uint64_t h = 1469598103934665603ull;
+        for (unsigned char c : key) {
+            h ^= c;
+            h *= 1099511628211ull;
+        }
+        return h;
+    }
+
+    bool open(const std::string& path) {
+        entries = nullptr;
+        count = 0;
+        if (!file.open(path))
+            return false;
+        PackHeader hdr;
+        if (file.size() < sizeof(hdr))
+            return fail();
+        std::memcpy(&hdr, file.data(), sizeof(hdr));
+        if (hdr.magic != kMagic || hdr.version != kVersion ||
+            hdr.tocOffset % alignof(PackEntry) != 0 ||
+            hdr.tocOffset + uint64_t(hdr.entryCount) * sizeof(PackEntry) > file.size() ||
+            hdr.namesOffset + hdr.namesSize > file.size())
+            return fail();
+        entries = reinterpret_cast<const PackEntry*>(file.data() + hdr.tocOffset);
+        count = hdr.entryCount;
+        names = reinterpret_cast<const char*>(file.data() + hdr.namesOffset);
+        namesSize = hdr.namesSize;
+        return true;
+    }
+
+    bool   valid() const { return entries != nullptr; }
+    size_t size()  const { return count; }
+
+    const PackEntry* find(const std::string& key) const {
+        const uint64_t h = hashKey(key);
+        const PackEntry* end = entries + count;
+        const PackEntry* it = std::lower_bound(entries, end, h,
+            [](const PackEntry& e, uint64_t v) { return e.hash < v; });
+        for (; it != end && it->hash == h; ++it)
+            if (it->nameLength == key.size() && it->nameOffset + it->nameLength <= namesSize &&
+                std::memcmp(names + it->nameOffset, key.data(), key.size()) == 0)
+                return it;
+        return nullptr;
+    }
+
+    // Stored entries borrow from the pack's mapping (the pack must outlive
+    // `out`); compressed ones are decoded into a buffer `out` owns
+    bool read(const std::string& key, MappedFile& out) const {
+        const PackEntry* e = find(key);
+        if (!e || e->offset + e->storedSize > file.size())
+            return false;
+        const unsigned char* src = file.data() + e->offset;
+        if (e->codec == Stored) {
+            if (e->storedSize != e->size)
+                return false;
+            out = MappedFile::borrow(src, size_t(e->size));
+            return out.valid();
+        }
+        if (e->codec != Lz || e->size == 0)
+            return false;
+        std::unique_ptr<unsigned char[]> buf(new unsigned char[size_t(e->size)]);
+        if (!LzBlock::decompress(src, size_t(e->storedSize), buf.get(), size_t(e->size))) {
+            std::cerr << "WARNING::ASSETPACK::CORRUPT_ENTRY " << key << std::endl;
+            return false;
+        }
+        out = MappedFile::adopt(std::move(buf), size_t(e->size));
+        return true;
+    }
+
+    // Encodes `data` with LzBlock if that saves at least 1/8 of it
+    static Input encode(std::string key, const unsigned char* data, size_t size, bool compress) {
+        Input in;
+        in.key = std::move(key);
+        in.size = size;
+        if (compress && size > 64) {
+            in.data.resize(LzBlock::compressBound(size));
+            size_t n = LzBlock::compress(data, size, in.data.data(), size - size / 8);
+            if (n) {
+                in.data.resize(n);
+                in.codec = Lz;
+                return in;
+            }
+        }
+        in.data.assign(data, data + size);
+        in.codec = Stored;
+        return in;
+    }
+
+    // Writes a pack through a temporary file and a rename
+    static bool write(const std::string& path, const std::vector<Input>& inputs) {
+        std::vector<PackEntry> toc(inputs.size());
+        std::string nameBlock;
+        uint64_t offset = kAlignment;   // header gets the first page
+        for (size_t i = 0; i < inputs.size(); ++i) {
+            PackEntry& e = toc[i];
+            e = PackEntry{};
+            e.hash = hashKey(inputs[i].key);
+            e.offset = offset;
+            e.storedSize = inputs[i].data.size();
+            e.size = inputs[i].size;
+            e.codec = inputs[i].codec;
+            e.nameLength = static_cast<uint32_t>(inputs[i].key.size());
+            e.nameOffset = nameBlock.size();
+            nameBlock += inputs[i].key;
+            offset = alignUp(offset + e.storedSize);
+        }
+        PackHeader hdr{};
+        hdr.magic = kMagic;
+        hdr.version = kVersion;
+        hdr.entryCount = static_cast<uint32_t>(toc.size());
+        hdr.tocOffset = offset;
+        hdr.namesOffset = offset + toc.size() * sizeof(PackEntry);
+        hdr.namesSize = nameBlock.size();
+        std::sort(toc.begin(), toc.end(),
+            [](const PackEntry& a, const PackEntry& b) { return a.hash < b.hash; });
+
+        std::error_code ec;
+        std::filesystem::create_directories(std::filesystem::path(path).parent_path(), ec);
+        const std::string tmpPath = path + ".tmp";
+        {
+            std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+            if (!out)
+                return false;
+            std::vector<char> pad(kAlignment, 0);
+            out.write(reinterpret_cast<const char*>(&hdr), sizeof(hdr));
+            out.write(pad.data(), std::streamsize(kAlignment - sizeof(hdr)));
+            uint64_t pos = kAlignment;
+            for (const Input& in : inputs) {
+                out.write(reinterpret_cast<const char*>(in.data.data()), std::streamsize(in.data.size()));
+                pos += in.data.size();
+                const uint64_t next = alignUp(pos);
+                out.write(pad.data(), std::streamsize(next - pos));
+                pos = next;
+            }
+            out.write(reinterpret_cast<const char*>(toc.data()), std::streamsize(toc.size() * sizeof(PackEntry)));
+            out.write(nameBlock.data(), std::streamsize(nameBlock.size()));
+            if (!out)
+                return false;
+        }
+        std::filesystem::remove(path, ec);
+        std::filesystem::rename(tmpPath, path, ec);
+        return !ec;
+    }
+
+private:
+    static uint64_t alignUp(uint64_t v) { return (v + kAlignment - 1) & ~uint64_t(kAlignment - 1); }
+
+    bool fail() {
+        file.close();
+        return false;
+    }
+
+    MappedFile       file;
+    const PackEntry* entries = nullptr;
+    size_t           count = 0;
+    const char*      names = nullptr;
+    uint64_t         namesSize = 0;
+};
+
+// Mounted packs, searched newest first before the loose file system. Mount
+// and unmount only while no loads are in flight: lookups take no lock.
+namespace AssetFiles {
+
+inline std::vector<std::unique_ptr<AssetPack>>& mounted() {
+    static std::vector<std::unique_ptr<AssetPack>> packs;
+    return packs;
+}
+
+inline bool mountPack(const std::string& path) {
+    auto pack = std::make_unique<AssetPack>();
+    if (!pack->open(path))
+        return false;
+    mounted().push_back(std::move(pack));
+    return true;
+}
+
+inline void unmountAll() { mounted().clear(); }
+
+// Pack entry for `path` if any pack has it, else the loose file mapped
+inline bool open(const std::string& path, MappedFile& out) {
+    const auto& packs = mounted();
+    if (!packs.empty()) {
+        const std::string key = AssetPack::keyFor(path);
+        for (auto it = packs.rbegin(); it != packs.rend(); ++it)
+            if ((*it)->read(key, out))
+                return true;
+    }
+    return out.open(path);
+}
+
+inline bool exists(const std::string& path) {
+    const auto& packs = mounted();
+    if (!packs.empty()) {
+        const std::string key = AssetPack::keyFor(path);
+        for (const auto& pack : packs)
+            if (pack->find(key))
+                return true;
+    }
+    std::error_code ec;
+    return std::filesystem::is_regular_file(path, ec);
+}
+
+} // namespace AssetFiles
@@ -0,0 +1,332 @@
+#pragma once
+
+#include <algorithm>
+#include <cfloat>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "FrustumCull.h"
+
+// Bounding volume hierarchy over item boxes, for frustum, occlusion and ray
+// queries. Built top-down with binned SAH; subtrees above a size threshold
+// are built on their own threads. Nodes are stored flattened depth-first in
+// one array (32 bytes each): an inner node's left child follows it, its
+// right child is at `first`. Moving items do not need a rebuild: refit()
+// recomputes the boxes with the same topology.
+//
+// Items are indices into the box arrays the caller passes in; the tree does
+// not know what they are.
+namespace Bvh {
+
+struct Node {
+    float    lo[3];
+    uint32_t first;   // leaf: offset into the item order; inner: right child
+    float    hi[3];
+    uint32_t count;   // leaf: item count; 0 for inner nodes
+};
+static_assert(sizeof(Node) == 32, "Bvh::Node must stay 32 bytes");
+
+class Tree {
+public:
+    static constexpr uint32_t kMaxLeafItems = 4;
+
+    // Builds over boxes [lo[i], hi[i]]; replaces any previous tree
+    void build(const std::vector<glm::vec3>& lo, const std::vector<glm::vec3>& hi) {
+        nodes.clear();
+        order.resize(lo.size());
+        for (size_t i = 0; i < order.size(); ++i)
+            order[i] = uint32_t(i);
+        if (order.empty())
+            return;
+        centroids.resize(lo.size());
+        for (size_t i = 0; i < lo.size(); ++i)
+            centroids[i] = (lo[i] + hi[i]) * 0.5f;
+        const Input in{ lo, hi };
+        buildRange(in, 0, uint32_t(order.size()), 0, nodes);
+        centroids.clear();
+        centroids.shrink_to_fit();
+    }
+
+    // Same items, new boxes: children follow their parents, so one reverse
+    // pass updates every node
+    void refit(const std::vector<glm::vec3>& lo, const std::vector<glm::vec3>& hi) {
+        for (size_t n = nodes.size(); n-- > 0;) {
+            Node& node = nodes[n];
+            glm::vec3 a(FLT_MAX), b(-FLT_MAX);
+            if (node.count) {
+                for (uint32_t i = 0; i < node.count; ++i) {
+                    a = glm::min(a, lo[order[node.first + i]]);
+                    b = glm::max(b, hi[order[node.first + i]]);
+                }
+            }
+            else {
+                const Node& l = nodes[n + 1];
+                const Node& r = nodes[node.first];
+                a = glm::min(lowOf(l), lowOf(r));
+                b = glm::max(highOf(l), highOf(r));
+            }
+            setBox(node, a, b);
+        }
+    }
+
+    bool   empty()     const { return nodes.empty(); }
+    size_t nodeCount() const { return nodes.size(); }
+    size_t itemCount() const { return order.size(); }
+    const std::vector<Node>& getNodes() const { return nodes; }
+
+    // Calls visit(item) for every item whose node box touches the frustum.
+    // A subtree entirely inside a plane stops testing it; one inside all
+    // six is emitted without further tests.
+    template <typename F>
+    void queryFrustum(const FrustumCull::Frustum& frustum, F&& visit) const {
+        if (nodes.empty())
+            return;
+        struct Entry { uint32_t node; uint32_t mask; };
+        Entry stack[64];
+        int top = 0;
+        stack[top++] = { 0, 0x3F };
+        while (top > 0) {
+            const Entry e = stack[--top];
+            const Node& node = nodes[e.node];
+            uint32_t mask = e.mask;
+            bool outside = false;
+            for (int p = 0; p < 6 && !outside; ++p) {
+                if (!(mask & (1u << p)))
+                    continue;
+                const glm::vec4& pl = frustum.planes[p];
+                // Furthest and nearest corners along the normal
+                const float outer = pl.x * (pl.x >= 0.0f ? node.hi[0] : node.lo[0]) +
+                                  pl.y * (pl.y >= 0.0f ? node.hi[1] : node.lo[1]) +
+                                  pl.z * (pl.z >= 0.0f ? node.hi[2] : node.lo[2]) + pl.w;
+                if (outer < 0.0f) {
+                    outside = true;
+                    break;
+                }
+                const float inner = pl.x * (pl.x >= 0.0f ? node.lo[0] : node.hi[0]) +
+                                   pl.y * (pl.y >= 0.0f ? node.lo[1] : node.hi[1]) +
+                                   pl.z * (pl.z >= 0.0f ? node.lo[2] : node.hi[2]) + pl.w;
+                if (inner >= 0.0f)
+                    mask &= ~(1u << p);
+            }
+            if (outside)
+                continue;
+            if (node.count) {
+                for (uint32_t i = 0; i < node.count; ++i)
+                    visit(order[node.first + i]);
+                continue;
+            }
+            stack[top++] = { node.first, mask };
+            stack[top++] = { e.node + 1, mask };
+        }
+    }
+
+    // Closest hit along origin + t * dir, t in [0, tMax]. hit(item, tMax)
+    // refines a candidate whose box the ray enters before tMax: it returns
+    // true and lowers tMax when the item is hit closer. Returns the item
+    // hit, or -1.
+    template <typename F>
+    int raycast(const glm::vec3& origin, const glm::vec3& dir, float& tMax, F&& hit) const {
+        if (nodes.empty())
+            return -1;
+        const glm::vec3 inv(1.0f / dir.x, 1.0f / dir.y, 1.0f / dir.z);
+        int best = -1;
+        uint32_t stack[64];
+        int top = 0;
+        stack[top++] = 0;
+        while (top > 0) {
+            const Node& node = nodes[stack[--top]];
+            if (slab(node, origin, inv, tMax) > tMax)
+                continue;
+            if (node.count) {
+                for (uint32_t i = 0; i < node.count; ++i)
+                    if (hit(order[node.first + i], tMax))
+                        best = int(order[node.first + i]);
+                continue;
+            }
+            // Nearer child on top of the stack, so it can shrink tMax first
+            const uint32_t left = uint32_t(&node - nodes.data()) + 1, right = node.first;
+            const float tl = slab(nodes[left], origin, inv, tMax);
+            const float tr = slab(nodes[right], origin, inv, tMax);
+            if (tl <= tr) {
+                if (tr <= tMax) stack[top++] = right;
+                if (tl <= tMax) stack[top++] = left;
+            }
+            else {
+                if (tl <= tMax) stack[top++] = left;
+                if (tr <= tMax) stack[top++] = right;
+            }
+        }
+        return best;
+    }
+
+    // Entry distance in [0, tMax] of a ray (`inv` = 1 / direction) into a
+    // box, FLT_MAX if it misses
+    static float rayBox(const glm::vec3& lo, const glm::vec3& hi, const glm::vec3& origin,
+                        const glm::vec3& inv, float tMax) {
+        float t0 = 0.0f, t1 = tMax;
+        for (int k = 0; k < 3; ++k) {
+            float a = (lo[k] - origin[k]) * inv[k];
+            float b = (hi[k] - origin[k]) * inv[k];
+            if (a > b)
+                std::swap(a, b);
+            t0 = std::max(t0, a);
+            t1 = std::min(t1, b);
+        }
+        return t0 <= t1 ? t0 : FLT_MAX;
+    }
+
+private:
+    static float slab(const Node& node, const glm::vec3& origin, const glm::vec3& inv, float tMax) {
+        return rayBox(lowOf(node), highOf(node), origin, inv, tMax);
+    }
+
+    static constexpr int      kBins = 12;
+    static constexpr uint32_t kParallelItems = 2048;   // smaller subtrees stay on one thread
+    static constexpr int      kParallelDepth = 4;      // at most 2^4 - 1 extra threads
+    static constexpr int      kMaxDepth = 60;          // leaves the query stacks headroom
+
+    struct Input {
+        const std::vector<glm::vec3>& lo;
+        const std::vector<glm::vec3>& hi;
+    };
+
+    static glm::vec3 lowOf(const Node& n)  { return glm::vec3(n.lo[0], n.lo[1], n.lo[2]); }
+    static glm::vec3 highOf(const Node& n) { return glm::vec3(n.hi[0], n.hi[1], n.hi[2]); }
+
+    static void setBox(Node& n, const glm::vec3& a, const glm::vec3& b) {
+        for (int k = 0; k < 3; ++k) {
+            n.lo[k] = a[k];
+            n.hi[k] = b[k];
+        }
+    }
+
+    static float area(const glm::vec3& a, const glm::vec3& b) {
+        const glm::vec3 e = glm::max(b - a, glm::vec3(0.0f));
+        return e.x * e.y + e.y * e.z + e.z * e.x;
+    }
+
+    // Appends the subtree over order[begin, end) to `out`, root first.
+    // Ranges are disjoint, so sibling subtrees can partition `order` on
+    // different threads.
+    void buildRange(const Input& in, uint32_t begin, uint32_t end, int depth, std::vector<Node>& out) {
+        glm::vec3 lo(FLT_MAX), hi(-FLT_MAX), clo(FLT_MAX), chi(-FLT_MAX);
+        for (uint32_t i = begin; i < end; ++i) {
+            lo = glm::min(lo, in.lo[order[i]]);
+            hi = glm::max(hi, in.hi[order[i]]);
+            clo = glm::min(clo, centroids[order[i]]);
+            chi = glm::max(chi, centroids[order[i]]);
+        }
+        const size_t self = out.size();
+        out.push_back(Node{});
+        setBox(out[self], lo, hi);
+        const uint32_t count = end - begin;
+        auto makeLeaf = [&] {
+            out[self].first = begin;
+            out[self].count = count;
+        };
+        if (count <= 1 || depth >= kMaxDepth)
+            return makeLeaf();
+
+        // Binned SAH along the widest centroid axis
+        const glm::vec3 extent = chi - clo;
+        const int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+        uint32_t mid = begin + count / 2;
+        if (extent[axis] > 0.0f) {
+            struct Bin { glm::vec3 lo{ FLT_MAX }, hi{ -FLT_MAX }; uint32_t n = 0; };
+            Bin bins[kBins];
+            const float scale = kBins / extent[axis];
+            auto binOf = [&](uint32_t item) {
+                return std::min(kBins - 1, int((centroids[item][axis] - clo[axis]) * scale));
+            };
+            for (uint32_t i = begin; i < end; ++i) {
+                Bin& b = bins[binOf(order[i])];
+                b.lo = glm::min(b.lo, in.lo[order[i]]);
+                b.hi = glm::max(b.hi, in.hi[order[i]]);
+                ++b.n;
+            }
+            // Sweep from the right, then from the left, costing each split
+            float rightCost[kBins];
+            glm::vec3 rlo(FLT_MAX), rhi(-FLT_MAX);
+            uint32_t rn = 0;
+            for (int b = kBins - 1; b > 0; --b) {
+                rlo = glm::min(rlo, bins[b].lo);
+                rhi = glm::max(rhi, bins[b].hi);
+                rn += bins[b].n;
+                rightCost[b] = rn ? area(rlo, rhi) * float(rn) : 0.0f;
+            }
+            glm::vec3 llo(FLT_MAX), lhi(-FLT_MAX);
+            uint32_t ln = 0;
+            float bestCost = FLT_MAX;
+            int bestSplit = -1;
+            for (int b = 0; b < kBins - 1; ++b) {
+                llo = glm::min(llo, bins[b].lo);
+                lhi = glm::max(lhi, bins[b].hi);
+                ln += bins[b].n;
+                if (ln == 0 || ln == count)
+                    continue;
+                const float cost = area(llo, lhi) * float(ln) + rightCost[b + 1];
+                if (cost < bestCost) {
+                    bestCost = cost;
+                    bestSplit = b;
+                }
+            }
+            // Cost in item tests, with one node visit per split
+            const float parentArea = area(lo, hi);
+            const float splitCost = parentArea > 0.0f ? 1.0f + bestCost / parentArea : FLT_MAX;
+            if (count <= kMaxLeafItems && (bestSplit < 0 || float(count) <= splitCost))
+                return makeLeaf();
+            if (bestSplit >= 0)
+                mid = uint32_t(std::partition(order.begin() + begin, order.begin() + end,
+                    [&](uint32_t item) { return binOf(item) <= bestSplit; }) - order.begin());
+        }
+        else if (count <= kMaxLeafItems) {
+            return makeLeaf();
+        }
+        if (mid == begin || mid == end) {
+            // Every centroid in one place: split by position in the range
+            mid = begin + count / 2;
+            std::nth_element(order.begin() + begin, order.begin() + mid, order.begin() + end,
+                [&](uint32_t a, uint32_t b) { return centroids[a][axis] < centroids[b][axis]; });
+        }
+
+        // The left child follows directly; a large right subtree is built
+        // on another thread into its own array and appended after
+        if (count >= kParallelItems && depth < kParallelDepth) {
+            std::vector<Node> right;
+            auto task = std::async(std::launch::async,
+                [&] { buildRange(in, mid, end, depth + 1, right); });
+            buildRange(in, begin, mid, depth + 1, out);
+            task.get();
+            append(out, right, self);
+        }
+        else {
+            buildRange(in, begin, mid, depth + 1, out);
+            out[self].first = uint32_t(out.size());
+            out[self].count = 0;
+            buildRange(in, mid, end, depth + 1, out);
+        }
+    }
+
+    // Moves a subtree built with local indices to the end of `out` and makes
+    // it the right child of out[parent]
+    static void append(std::vector<Node>& out, const std::vector<Node>& sub, size_t parent) {
+        const uint32_t base = uint32_t(out.size());
+        out[parent].first = base;
+        out[parent].count = 0;
+        for (Node n : sub) {
+            if (!n.count)
+                n.first += base;
+            out.push_back(n);
+        }
+    }
+
+    std::vector<Node>      nodes;
+    std::vector<uint32_t>  order;       // item ids, each leaf a contiguous run
+    std::vector<glm::vec3> centroids;   // build only
+};
+
+} // namespace Bvh
@@ -0,0 +1,196 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "AssetPack.h"
+#include "MappedFile.h"
+#include "MeshCache.h"
+
+// Runtime-ready outputs of the offline asset compiler (assetc).
+//
+// Meshes: welded, cache-ordered geometry with quantized vertices.
+//   MeshHeader | MeshCache::MeshRecord[meshCount] | vertex/index blobs
+//
+// Outputs mirror the source tree under kOutputDir, e.g. models/city.obj ->
+// compiled/models/city.obj.render-optimized.mesh. They carry no source
+// stamp: keeping them current is assetc's job, not the runtime's.
+namespace CompiledAsset {
+
+constexpr uint32_t kMeshMagic    = 0x4D574D4D; // "MMWM"
+constexpr uint32_t kVersion      = 1;
+// assetc's; bump whenever the same input would produce different output
+// (also recorded in world tile indexes, see WorldTiles.h)
+constexpr uint32_t kToolVersion  = 2;
+const char* const  kOutputDir    = "compiled";
+
+// 12 bytes instead of 24: position as unorm16 inside the file's bounds,
+// normal as snorm 10:10:10:2 (GL_INT_2_10_10_10_REV)
+struct QuantizedVertex {
+    uint16_t position[4];  // xyz, w unused
+    uint32_t normal;
+};
+static_assert(sizeof(QuantizedVertex) == 12, "QuantizedVertex must stay 12 bytes");
+
+struct MeshHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t vertexStride;
+    uint32_t meshCount;
+    float    boundsMin[3];
+    float    boundsMax[3];
+};
+
+// Source path relative to the working directory, '/'-separated (the same
+// key an AssetPack files it under)
+inline std::string relativeSource(const std::string& source) {
+    return AssetPack::keyFor(source);
+}
+
+inline std::string meshPathFor(const std::string& source, const char* profile,
+                               const std::string& outDir = kOutputDir) {
+    return (std::filesystem::path(outDir) / (relativeSource(source) + '.' + profile + ".mesh")).string();
+}
+
+inline uint32_t packSnorm10(float v, unsigned shift) {
+    v = v < -1.0f ? -1.0f : (v > 1.0f ? 1.0f : v);
+    int32_t q = static_cast<int32_t>(std::lround(v * 511.0f));
+    return (static_cast<uint32_t>(q) & 0x3FFu) << shift;
+}
+
+inline float unpackSnorm10(uint32_t packed, unsigned shift) {
+    int32_t q = static_cast<int32_t>((packed >> shift) & 0x3FFu);
+    if (q & 0x200)
+        q -= 0x400;
+    float v = static_cast<float>(q) / 511.0f;
+    return v < -1.0f ? -1.0f : v;
+}
+
+// The runtime draws quantized meshes through a translate(min)*scale(extent)
+// node transform, so positions are stored in [0,1] and normals are
+// pre-multiplied by the extent to survive the inverse-transpose
+inline QuantizedVertex quantize(const float* position, const float* normal,
+                                const MeshCache::Bounds& bounds) {
+    QuantizedVertex q{};
+    float n[3], len = 0.0f;
+    for (int k = 0; k < 3; ++k) {
+        float extent = bounds.max[k] - bounds.min[k];
+        float t = extent > 0.0f ? (position[k] - bounds.min[k]) / extent : 0.0f;
+        t = t < 0.0f ? 0.0f : (t > 1.0f ? 1.0f : t);
+        q.position[k] = static_cast<uint16_t>(std::lround(t * 65535.0f));
+        n[k] = normal[k] * (extent > 0.0f ? extent : 1.0f);
+        len += n[k] * n[k];
+    }
+    len = len > 0.0f ? 1.0f / std::sqrt(len) : 0.0f;
+    q.normal = packSnorm10(n[0] * len, 0) | packSnorm10(n[1] * len, 10) | packSnorm10(n[2] * len, 20);
+    return q;
+}
+
+// Inverse of quantize(), for callers that need float geometry on the CPU
+inline void dequantize(const QuantizedVertex& q, const MeshCache::Bounds& bounds,
+                       float* position, float* normal) {
+    float len = 0.0f;
+    for (int k = 0; k < 3; ++k) {
+        float extent = bounds.max[k] - bounds.min[k];
+        position[k] = bounds.min[k] + extent * (q.position[k] / 65535.0f);
+        normal[k] = unpackSnorm10(q.normal, 10 * k) / (extent > 0.0f ? extent : 1.0f);
+        len += normal[k] * normal[k];
+    }
+    len = len > 0.0f ? 1.0f / std::sqrt(len) : 0.0f;
+    for (int k = 0; k < 3; ++k)
+        normal[k] *= len;
+}
+
+// Maps the compiled mesh for `source` (from a mounted pack if one has it)
+// and fills `meshes` with views into it
+inline bool loadMesh(const std::string& source, const char* profile, MappedFile& file,
+                     std::vector<MeshCache::MeshBlob>& meshes, MeshCache::Bounds& bounds) {
+    if (!AssetFiles::open(meshPathFor(source, profile), file))
+        return false;
+    const unsigned char* base = file.data();
+    MeshHeader hdr;
+    if (file.size() < sizeof(hdr))
+        return false;
+    std::memcpy(&hdr, base, sizeof(hdr));
+    if (hdr.magic != kMeshMagic || hdr.version != kVersion ||
+        hdr.vertexStride != sizeof(QuantizedVertex))
+        return false;
+    std::memcpy(bounds.min, hdr.boundsMin, sizeof(bounds.min));
+    std::memcpy(bounds.max, hdr.boundsMax, sizeof(bounds.max));
+
+    const size_t tableOffset = MeshCache::align16(sizeof(MeshHeader));
+    if (tableOffset + size_t(hdr.meshCount) * sizeof(MeshCache::MeshRecord) > file.size())
+        return false;
+    meshes.clear();
+    meshes.reserve(hdr.meshCount);
+    for (uint32_t i = 0; i < hdr.meshCount; ++i) {
+        MeshCache::MeshRecord rec;
+        std::memcpy(&rec, base + tableOffset + i * sizeof(rec), sizeof(rec));
+        if (!MeshCache::recordFits(rec, sizeof(QuantizedVertex), file.size()))
+            return false;
+        meshes.push_back({ base + rec.vertexOffset, size_t(rec.vertexCount),
+            reinterpret_cast<const uint32_t*>(base + rec.indexOffset), size_t(rec.indexCount) });
+    }
+    return true;
+}
+
+// Writes `data` to `path` through a temporary file and a rename
+inline bool writeAtomically(const std::string& path, const std::vector<unsigned char>& data) {
+    std::error_code ec;
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path(), ec);
+    const std::string tmpPath = path + ".tmp";
+    {
+        std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!out)
+            return false;
+        out.write(reinterpret_cast<const char*>(data.data()), std::streamsize(data.size()));
+        if (!out)
+            return false;
+    }
+    std::filesystem::remove(path, ec);
+    std::filesystem::rename(tmpPath, path, ec);
+    return !ec;
+}
+
+// `meshes` vertices must be QuantizedVertex
+inline bool writeMesh(const std::string& path, const std::vector<MeshCache::MeshBlob>& meshes,
+                      const MeshCache::Bounds& bounds) {
+    MeshHeader hdr{};
+    hdr.magic = kMeshMagic;
+    hdr.version = kVersion;
+    hdr.vertexStride = sizeof(QuantizedVertex);
+    hdr.meshCount = static_cast<uint32_t>(meshes.size());
+    std::memcpy(hdr.boundsMin, bounds.min, sizeof(hdr.boundsMin));
+    std::memcpy(hdr.boundsMax, bounds.max, sizeof(hdr.boundsMax));
+
+    const size_t tableOffset = MeshCache::align16(sizeof(MeshHeader));
+    std::vector<MeshCache::MeshRecord> table(meshes.size());
+    size_t offset = MeshCache::align16(tableOffset + table.size() * sizeof(MeshCache::MeshRecord));
+    for (size_t i = 0; i < meshes.size(); ++i) {
+        table[i].vertexOffset = offset;
+        table[i].vertexCount = meshes[i].vertexCount;
+        offset = MeshCache::align16(offset + meshes[i].vertexCount * sizeof(QuantizedVertex));
+        table[i].indexOffset = offset;
+        table[i].indexCount = meshes[i].indexCount;
+        offset = MeshCache::align16(offset + meshes[i].indexCount * sizeof(uint32_t));
+    }
+
+    std::vector<unsigned char> out(offset, 0);
+    std::memcpy(out.data(), &hdr, sizeof(hdr));
+    std::memcpy(out.data() + tableOffset, table.data(), table.size() * sizeof(MeshCache::MeshRecord));
+    for (size_t i = 0; i < meshes.size(); ++i) {
+        std::memcpy(out.data() + table[i].vertexOffset, meshes[i].vertices,
+            meshes[i].vertexCount * sizeof(QuantizedVertex));
+        std::memcpy(out.data() + table[i].indexOffset, meshes[i].indices,
+            meshes[i].indexCount * sizeof(uint32_t));
+    }
+    return writeAtomically(path, out);
+}
+
+} // namespace CompiledAsset
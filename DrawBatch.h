@@ -0,0 +1,691 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cfloat>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "FrustumCull.h"
+#include "GpuCull.h"
+#include "GpuMemory.h"
+#include "MeshArena.h"
+#include "Model.h"
+#include "Occlusion.h"
+
+// Collects a frame's arena meshes and submits them as one
+// glMultiDrawElementsIndirect per arena. Per-draw data (model matrix,
+// color) goes to an SSBO at binding kDrawDataBinding; the shader reads it
+// at the draw index MeshArena feeds through attribute 2. Every placement of
+// the same mesh becomes one instanced command whose instances read
+// consecutive entries, so repeated objects cost no extra commands. Meshes outside
+// the arenas (glTF, which draws out of its own bufferViews) are queued
+// separately and drawn one by one through the uniform path.
+//
+// Before either flush, every mesh's box is moved to world space and tested
+// against the frustum given to begin(); meshes outside it are dropped, and
+// so are those the occlusion culler (if set) finds hidden.
+//
+// With a GpuCull set, static objects can be made resident instead (see
+// updateResident()): their placements, boxes and commands stay in GPU
+// buffers across frames and are only rewritten when an object changes, and
+// a compute pass fills the commands' instance counts each frame. What is
+// still add()ed (moving or animated objects) takes the path above; so do
+// the resident objects' loose meshes, tested against the frustum on the
+// CPU. Context thread only.
+class DrawBatch {
+public:
+    static constexpr GLuint kDrawDataBinding = 0;
+
+    // Matches the std430 block in the batch vertex shader
+    struct DrawData {
+        glm::mat4 model;
+        glm::vec4 color;
+    };
+
+    struct Stats {
+        size_t added = 0;        // mesh instances given to add()
+        size_t visible = 0;      // of those, inside the frustum (CPU culling)
+        size_t occluded = 0;     // inside the frustum but hidden
+        size_t draws = 0;        // visible instances submitted through the arenas
+        size_t commands = 0;     // indirect commands (one per distinct mesh)
+        size_t multiDraws = 0;   // glMultiDrawElementsIndirect calls
+        size_t loose = 0;        // meshes drawn one by one
+        size_t resident = 0;     // resident placements given to the GPU cull
+    };
+
+    DrawBatch() = default;
+    ~DrawBatch() { release(); }
+
+    DrawBatch(const DrawBatch&) = delete;
+    DrawBatch& operator=(const DrawBatch&) = delete;
+
+    void begin(const glm::mat4& viewProj) {
+        frustum = FrustumCull::extractFrustum(viewProj);
+        pending.clear();
+        boxes.clear();
+        groups.clear();
+        groupOf.clear();
+        visibleGroup.clear();
+        loose.clear();
+        prepared = false;
+    }
+
+    // With culling off every added mesh is drawn (for comparison)
+    void setCulling(bool on) { culling = on; }
+
+    // Rasterized culler to test the frustum survivors against, or null
+    void setOcclusion(Occlusion::Culler* culler) { occlusion = culler; }
+
+    // Culls the resident placements on the GPU, or null to drop them
+    void setGpuCulling(GpuCull* culler) {
+        if (!culler)
+            clearResident();
+        gpu = culler;
+    }
+
+    void add(const Mesh& mesh, const glm::mat4& matrix, const glm::vec3& color) {
+        if (mesh.hasBounds) {
+            glm::vec3 lo, hi;
+            FrustumCull::transformBox(matrix, mesh.boundsMin, mesh.boundsMax, lo, hi);
+            boxes.add(lo, hi);
+        }
+        else {
+            boxes.add(glm::vec3(-FLT_MAX), glm::vec3(FLT_MAX));
+        }
+        pending.push_back({ &mesh, { matrix, glm::vec4(color, 1.0f) } });
+    }
+
+    // Every mesh of `model` that add() would take, at `objectMatrix`
+    void add(const Model& model, const glm::mat4& objectMatrix, const glm::vec3& color,
+             const glm::mat4* nodeMatrices = nullptr) {
+        model.forEachMesh(objectMatrix, nodeMatrices,
+            [&](const Mesh& mesh, const glm::mat4& m) { add(mesh, m, color); });
+    }
+
+    // Needs a GpuCull. `visit(place)` must call place(key, model, matrix,
+    // color) for every static object, keys being small integers (they index
+    // a table); a null or not-ready model leaves the key empty. Only objects
+    // whose model, readiness, matrix or color changed are rewritten, and
+    // keys not visited are dropped. Call it whenever one of those may have
+    // changed (see Model::residencyVersion()); a model must not be freed
+    // while it is still placed here.
+    template <typename Visit>
+    void updateResident(Visit&& visit) {
+        if (!gpu)
+            return;
+        // Changed objects go first: a mesh freed since the last update may
+        // already have a new one at its address
+        for (Resident& r : residents)
+            r.seen = false;
+        visit([&](uint32_t key, const Model* model, const glm::mat4& matrix, const glm::vec3& color) {
+            if (key >= residents.size())
+                residents.resize(size_t(key) + 1);
+            Resident& r = residents[key];
+            r.seen = true;
+            if (!(r.placed && r.model == model && model && model->isReady() && r.matrix == matrix && r.color == color))
+                unplace(key);
+        });
+        for (uint32_t key = 0; key < residents.size(); ++key)
+            if (!residents[key].seen)
+                unplace(key);
+        visit([&](uint32_t key, const Model* model, const glm::mat4& matrix, const glm::vec3& color) {
+            if (!residents[key].placed)
+                place(key, model, matrix, color);
+        });
+        if (looseChanged) {
+            residentLooseBoxes.clear();
+            for (const ResidentLoose& l : residentLoose)
+                residentLooseBoxes.add(l.lo, l.hi);
+            looseChanged = false;
+        }
+    }
+
+    // Draws the visible arena meshes with the bound batch program
+    void flush() {
+        prepare();
+        flushAdded();
+        flushResident();
+        glBindVertexArray(0);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    }
+
+    // Draws the rest with the bound uniform program
+    void flushLoose(GLint modelLoc, GLint colorLoc) {
+        prepare();
+        stats.loose = loose.size();
+        for (const Loose& l : loose) {
+            glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(l.matrix));
+            glUniform3fv(colorLoc, 1, glm::value_ptr(l.color));
+            l.mesh->Draw();
+        }
+    }
+
+    const Stats& getStats() const { return stats; }
+
+    // Resident placements the last flush drew. Reads the commands back, so
+    // it waits for the GPU; for occasional stats only.
+    size_t readGpuVisible() const {
+        if (!gpu || !residentPlacements || !residentCommandBuffer)
+            return 0;
+        // The cull pass wrote the counts from a shader
+        glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+        std::vector<Command> counted(commandTemplate.size());
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, residentCommandBuffer);
+        glGetBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, GLsizeiptr(counted.size() * sizeof(Command)),
+            counted.data());
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        size_t n = 0;
+        for (const Command& c : counted)
+            n += c.instanceCount;
+        return n;
+    }
+
+    void release() {
+        clearResident();
+        GpuMemory::deleteBuffer(drawBuffer, GpuMemory::Kind::Staging);
+        GpuMemory::deleteBuffer(commandBuffer, GpuMemory::Kind::Staging);
+        GpuMemory::deleteBuffer(placementBuffer, GpuMemory::Kind::Staging);
+        GpuMemory::deleteBuffer(itemBuffer, GpuMemory::Kind::Staging);
+        GpuMemory::deleteBuffer(templateBuffer, GpuMemory::Kind::Staging);
+        GpuMemory::deleteBuffer(residentCommandBuffer, GpuMemory::Kind::Staging);
+        GpuMemory::deleteBuffer(residentDrawBuffer, GpuMemory::Kind::Staging);
+        drawCapacity = commandCapacity = placementCapacity = itemCapacity = 0;
+        templateCapacity = residentCommandCapacity = residentDrawCapacity = 0;
+    }
+
+private:
+    // Layout fixed by GL for indirect indexed draws
+    struct Command {
+        GLuint count;
+        GLuint instanceCount;
+        GLuint firstIndex;
+        GLint  baseVertex;
+        GLuint baseInstance;
+    };
+
+    // Placements of one mesh this frame
+    struct Group {
+        MeshArena::Slot slot;
+        uint32_t        first;
+        uint32_t        count;
+        uint32_t        command;   // index in `commands`
+    };
+
+    struct Pending {
+        const Mesh* mesh;
+        DrawData    data;
+    };
+
+    static constexpr uint32_t kLoose = 0xFFFFFFFF;
+    // Item::command of an empty resident slot; the cull shader skips it
+    static constexpr uint32_t kNoCommand = 0xFFFFFFFF;
+
+    struct Loose {
+        const Mesh* mesh;
+        glm::mat4   matrix;
+        glm::vec4   color;
+    };
+
+    // One key of updateResident(): its arena meshes hold placement slots
+    // [first, first + count)
+    struct Resident {
+        const Model* model = nullptr;
+        glm::mat4    matrix{ 1.0f };
+        glm::vec3    color{ 0.0f };
+        size_t       first = 0;
+        size_t       count = 0;
+        bool         placed = false;
+        bool         seen = false;
+    };
+
+    struct ResidentLoose {
+        uint32_t    key;
+        const Mesh* mesh;
+        glm::mat4   matrix;
+        glm::vec4   color;
+        glm::vec3   lo, hi;
+    };
+
+    // A resident command: one mesh and how many slots draw it
+    struct CommandSlot {
+        const Mesh* mesh = nullptr;
+        uint32_t    placements = 0;
+    };
+
+    // Culls, then sorts the visible meshes into arena groups and loose draws
+    void prepare() {
+        if (prepared)
+            return;
+        prepared = true;
+        stats.added = pending.size();
+        if (culling) {
+            stats.visible = boxes.cull(frustum, visible);
+        }
+        else {
+            visible.assign(pending.size(), 1);
+            stats.visible = pending.size();
+        }
+        stats.occluded = 0;
+        if (culling && occlusion)
+            for (size_t i = 0; i < pending.size(); ++i) {
+                glm::vec3 lo, hi;
+                boxes.get(i, lo, hi);
+                if (visible[i] && lo.x > -FLT_MAX && !occlusion->visible(lo, hi)) {
+                    visible[i] = 0;
+                    ++stats.occluded;
+                }
+            }
+        visibleGroup.assign(pending.size(), kLoose);
+        for (size_t i = 0; i < pending.size(); ++i) {
+            if (!visible[i])
+                continue;
+            const Pending& p = pending[i];
+            const MeshArena::Slot& slot = p.mesh->arenaSlot();
+            if (!slot.valid) {
+                loose.push_back({ p.mesh, p.data.model, p.data.color });
+                continue;
+            }
+            auto found = groupOf.emplace(p.mesh, uint32_t(groups.size()));
+            if (found.second)
+                groups.push_back({ slot, 0, 0, 0 });
+            ++groups[found.first->second].count;
+            visibleGroup[i] = found.first->second;
+        }
+        // The GPU pass only sees arena meshes; resident loose ones are
+        // culled here like the rest
+        if (gpu && !residentLoose.empty()) {
+            if (culling)
+                residentLooseBoxes.cull(frustum, visible);
+            else
+                visible.assign(residentLoose.size(), 1);
+            for (size_t i = 0; i < residentLoose.size(); ++i)
+                if (visible[i])
+                    loose.push_back({ residentLoose[i].mesh, residentLoose[i].matrix, residentLoose[i].color });
+        }
+    }
+
+    // The add()ed meshes the CPU found visible
+    void flushAdded() {
+        stats.draws = 0;
+        stats.commands = groups.size();
+        stats.multiDraws = 0;
+        for (uint32_t g : visibleGroup)
+            stats.draws += g != kLoose;
+        if (!stats.draws)
+            return;
+
+        // Instances of a group go to consecutive entries starting at its
+        // first; commands are ordered by arena so each gets one range
+        uint32_t next = 0;
+        size_t perFormat[size_t(MeshArena::Format::Count)] = {};
+        for (Group& g : groups) {
+            g.first = next;
+            next += g.count;
+            ++perFormat[size_t(g.slot.format)];
+        }
+        size_t offset[size_t(MeshArena::Format::Count)] = {};
+        for (size_t f = 1; f < size_t(MeshArena::Format::Count); ++f)
+            offset[f] = offset[f - 1] + perFormat[f - 1];
+        commands.resize(groups.size());
+        for (Group& g : groups) {
+            g.command = uint32_t(offset[size_t(g.slot.format)]++);
+            Command& cmd = commands[g.command];
+            const MeshArena::Range& r = MeshArena::range(g.slot);
+            cmd.count = GLuint(r.indexCount);
+            cmd.instanceCount = g.count;
+            cmd.firstIndex = GLuint(r.firstIndex);
+            cmd.baseVertex = GLint(r.baseVertex);
+            cmd.baseInstance = g.first;
+        }
+
+        MeshArena::reserveDrawIds(stats.draws);
+        draws.resize(stats.draws);
+        for (Group& g : groups)
+            g.count = 0;
+        for (size_t i = 0; i < pending.size(); ++i) {
+            if (visibleGroup[i] == kLoose)
+                continue;
+            Group& g = groups[visibleGroup[i]];
+            draws[g.first + g.count++] = pending[i].data;
+        }
+        upload(GL_SHADER_STORAGE_BUFFER, drawBuffer, drawCapacity, draws.data(),
+            draws.size() * sizeof(DrawData));
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kDrawDataBinding, drawBuffer);
+        upload(GL_DRAW_INDIRECT_BUFFER, commandBuffer, commandCapacity, commands.data(),
+            commands.size() * sizeof(Command));
+
+        size_t first = 0;
+        for (size_t f = 0; f < size_t(MeshArena::Format::Count); ++f) {
+            const size_t n = perFormat[f];
+            if (!n)
+                continue;
+            glBindVertexArray(MeshArena::arena(MeshArena::Format(f)).vertexArray());
+            glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+                reinterpret_cast<void*>(first * sizeof(Command)), GLsizei(n), 0);
+            first += n;
+            ++stats.multiDraws;
+        }
+    }
+
+    // Uploads what changed in the resident set, resets the instance counts
+    // from the template, culls and draws
+    void flushResident() {
+        stats.resident = residentPlacements;
+        if (!gpu || !residentPlacements)
+            return;
+        stats.commands += commandOf.size();
+        if (MeshArena::generation() != commandsGeneration)
+            commandsDirty = true;   // the arenas moved some meshes
+        if (commandsDirty)
+            rebuildCommands();
+        uploadResident();
+
+        MeshArena::reserveDrawIds(residentPlacements);
+        const size_t commandBytes = commandTemplate.size() * sizeof(Command);
+        upload(GL_DRAW_INDIRECT_BUFFER, residentCommandBuffer, residentCommandCapacity, nullptr, commandBytes);
+        glBindBuffer(GL_COPY_READ_BUFFER, templateBuffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, residentCommandBuffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, GLsizeiptr(commandBytes));
+        upload(GL_SHADER_STORAGE_BUFFER, residentDrawBuffer, residentDrawCapacity, nullptr,
+            residentPlacements * sizeof(DrawData));
+
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kDrawDataBinding, residentDrawBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GpuCull::kPlacementBinding, placementBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GpuCull::kItemBinding, itemBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GpuCull::kCommandBinding, residentCommandBuffer);
+        gpu->cull(frustum, residentItems.size(), culling);
+
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, residentCommandBuffer);
+        for (size_t f = 0; f < size_t(MeshArena::Format::Count); ++f) {
+            const size_t n = residentCommands[f].size();
+            if (!n)
+                continue;
+            glBindVertexArray(MeshArena::arena(MeshArena::Format(f)).vertexArray());
+            glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+                reinterpret_cast<void*>(f * commandStride * sizeof(Command)), GLsizei(n), 0);
+            ++stats.multiDraws;
+        }
+    }
+
+    // Writes the arena meshes of a ready model into fresh slots; loose
+    // meshes go to residentLoose
+    void place(uint32_t key, const Model* model, const glm::mat4& matrix, const glm::vec3& color) {
+        Resident& r = residents[key];
+        if (!model || !model->isReady())
+            return;
+        size_t n = 0;
+        model->forEachMesh(matrix, nullptr, [&](const Mesh& mesh, const glm::mat4&) {
+            n += mesh.arenaSlot().valid;
+        });
+        r.model = model;
+        r.matrix = matrix;
+        r.color = color;
+        r.first = allocateSlots(n);
+        r.count = n;
+        r.placed = true;
+        size_t s = r.first;
+        const glm::vec4 c(color, 1.0f);
+        model->forEachMesh(matrix, nullptr, [&](const Mesh& mesh, const glm::mat4& m) {
+            glm::vec3 lo(-FLT_MAX), hi(FLT_MAX);
+            if (mesh.hasBounds)
+                FrustumCull::transformBox(m, mesh.boundsMin, mesh.boundsMax, lo, hi);
+            if (!mesh.arenaSlot().valid) {
+                residentLoose.push_back({ key, &mesh, m, c, lo, hi });
+                looseChanged = true;
+                return;
+            }
+            residentDraws[s] = { m, c };
+            residentItems[s] = { lo, commandFor(mesh), hi, 0 };
+            ++s;
+        });
+        markDirty(r.first, r.count);
+        residentPlacements += r.count;
+    }
+
+    void unplace(uint32_t key) {
+        Resident& r = residents[key];
+        if (!r.placed)
+            return;
+        for (size_t s = r.first; s < r.first + r.count; ++s) {
+            releaseCommand(residentItems[s].command);
+            residentItems[s] = emptyItem();
+        }
+        markDirty(r.first, r.count);
+        freeSlots.release(r.first, r.count);
+        residentPlacements -= r.count;
+        const size_t before = residentLoose.size();
+        residentLoose.erase(std::remove_if(residentLoose.begin(), residentLoose.end(),
+            [key](const ResidentLoose& l) { return l.key == key; }), residentLoose.end());
+        looseChanged = looseChanged || residentLoose.size() != before;
+        r = Resident();
+        r.seen = true;
+    }
+
+    static GpuCull::Item emptyItem() { return { glm::vec3(0.0f), kNoCommand, glm::vec3(0.0f), 0 }; }
+
+    // Contiguous slots, growing the arrays (and later the buffers) by
+    // doubling
+    size_t allocateSlots(size_t n) {
+        size_t first = 0;
+        while (!freeSlots.allocate(n, first)) {
+            const size_t old = residentItems.size();
+            const size_t capacity = std::max(std::max<size_t>(1024, old * 2), old + n);
+            residentDraws.resize(capacity);
+            residentItems.resize(capacity, emptyItem());
+            freeSlots.release(old, capacity - old);
+            residentResized = true;
+        }
+        return first;
+    }
+
+    void markDirty(size_t first, size_t count) {
+        if (count && !residentResized)
+            dirty.push_back({ first, count });
+    }
+
+    // Commands live in one block per arena, commandStride apart, so a slot
+    // keeps its index while others come and go
+    uint32_t commandFor(const Mesh& mesh) {
+        commandsDirty = true;
+        auto it = commandOf.find(&mesh);
+        if (it != commandOf.end()) {
+            ++commandSlot(it->second).placements;
+            return it->second;
+        }
+        const size_t f = size_t(mesh.arenaSlot().format);
+        uint32_t local;
+        if (!freeCommands[f].empty()) {
+            local = freeCommands[f].back();
+            freeCommands[f].pop_back();
+        }
+        else {
+            local = uint32_t(residentCommands[f].size());
+            residentCommands[f].emplace_back();
+            if (residentCommands[f].size() > commandStride)
+                widenCommandBlocks();
+        }
+        residentCommands[f][local] = { &mesh, 1 };
+        const uint32_t index = uint32_t(f * commandStride) + local;
+        commandOf.emplace(&mesh, index);
+        return index;
+    }
+
+    void releaseCommand(uint32_t index) {
+        if (index == kNoCommand)
+            return;
+        commandsDirty = true;
+        CommandSlot& slot = commandSlot(index);
+        if (--slot.placements)
+            return;
+        commandOf.erase(slot.mesh);
+        slot = CommandSlot();
+        freeCommands[index / commandStride].push_back(uint32_t(index % commandStride));
+    }
+
+    CommandSlot& commandSlot(uint32_t index) {
+        return residentCommands[index / commandStride][index % commandStride];
+    }
+
+    // Doubles the block size; every stored index moves with it
+    void widenCommandBlocks() {
+        const uint32_t old = commandStride;
+        commandStride = std::max<uint32_t>(64, commandStride * 2);
+        auto remap = [&](uint32_t& index) {
+            if (index != kNoCommand)
+                index = (index / old) * commandStride + index % old;
+        };
+        if (old) {
+            for (GpuCull::Item& item : residentItems)
+                remap(item.command);
+            for (auto& entry : commandOf)
+                remap(entry.second);
+        }
+        residentResized = true;
+    }
+
+    // Commands from the live meshes (the arenas may have moved them); each
+    // command's output range holds all its placements
+    void rebuildCommands() {
+        const size_t formats = size_t(MeshArena::Format::Count);
+        commandTemplate.assign(formats * commandStride, Command{ 0, 0, 0, 0, 0 });
+        GLuint next = 0;
+        for (size_t f = 0; f < formats; ++f)
+            for (size_t local = 0; local < residentCommands[f].size(); ++local) {
+                const CommandSlot& slot = residentCommands[f][local];
+                if (!slot.mesh)
+                    continue;
+                const MeshArena::Range& r = MeshArena::range(slot.mesh->arenaSlot());
+                commandTemplate[f * commandStride + local] =
+                    { GLuint(r.indexCount), 0, GLuint(r.firstIndex), GLint(r.baseVertex), next };
+                next += slot.placements;
+            }
+        upload(GL_COPY_WRITE_BUFFER, templateBuffer, templateCapacity, commandTemplate.data(),
+            commandTemplate.size() * sizeof(Command));
+        commandsGeneration = MeshArena::generation();
+        commandsDirty = false;
+    }
+
+    // Placement and item buffers keep their contents between frames, so
+    // only changed slots are written
+    void uploadResident() {
+        if (residentResized) {
+            writeWhole(placementBuffer, placementCapacity, residentDraws.data(),
+                residentDraws.size() * sizeof(DrawData));
+            writeWhole(itemBuffer, itemCapacity, residentItems.data(),
+                residentItems.size() * sizeof(GpuCull::Item));
+            residentResized = false;
+        }
+        else {
+            for (const auto& d : dirty) {
+                glBindBuffer(GL_SHADER_STORAGE_BUFFER, placementBuffer);
+                glBufferSubData(GL_SHADER_STORAGE_BUFFER, GLintptr(d.first * sizeof(DrawData)),
+                    GLsizeiptr(d.second * sizeof(DrawData)), residentDraws.data() + d.first);
+                glBindBuffer(GL_SHADER_STORAGE_BUFFER, itemBuffer);
+                glBufferSubData(GL_SHADER_STORAGE_BUFFER, GLintptr(d.first * sizeof(GpuCull::Item)),
+                    GLsizeiptr(d.second * sizeof(GpuCull::Item)), residentItems.data() + d.first);
+            }
+        }
+        dirty.clear();
+    }
+
+    void clearResident() {
+        if (residents.empty())
+            return;
+        residents.clear();
+        residentDraws.clear();
+        residentItems.clear();
+        residentLoose.clear();
+        residentLooseBoxes.clear();
+        freeSlots = MeshArena::FreeList();
+        for (size_t f = 0; f < size_t(MeshArena::Format::Count); ++f) {
+            residentCommands[f].clear();
+            freeCommands[f].clear();
+        }
+        commandOf.clear();
+        commandTemplate.clear();
+        dirty.clear();
+        commandStride = 0;
+        residentPlacements = 0;
+        residentResized = true;
+        commandsDirty = true;
+        looseChanged = false;
+    }
+
+    // Orphans the buffer each frame so the driver can hand out fresh storage
+    // while the previous frame's draws still read the old one; null data
+    // leaves it for the GPU to fill
+    static void upload(GLenum target, GLuint& buffer, size_t& capacity, const void* data, size_t bytes) {
+        if (!buffer)
+            glGenBuffers(1, &buffer);
+        glBindBuffer(target, buffer);
+        if (bytes > capacity)
+            capacity = std::max(bytes, capacity * 2);
+        glBufferData(target, GLsizeiptr(capacity), nullptr, GL_STREAM_DRAW);
+        if (data)
+            glBufferSubData(target, 0, GLsizeiptr(bytes), data);
+        GpuMemory::track(GpuMemory::Kind::Staging, buffer, capacity);
+    }
+
+    // Replaces a resident buffer's contents, keeping its storage when it fits
+    static void writeWhole(GLuint& buffer, size_t& capacity, const void* data, size_t bytes) {
+        if (!buffer)
+            glGenBuffers(1, &buffer);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+        if (bytes > capacity) {
+            capacity = bytes;
+            glBufferData(GL_SHADER_STORAGE_BUFFER, GLsizeiptr(capacity), data, GL_DYNAMIC_DRAW);
+        }
+        else {
+            glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, GLsizeiptr(bytes), data);
+        }
+        GpuMemory::track(GpuMemory::Kind::Staging, buffer, capacity);
+    }
+
+    FrustumCull::Frustum  frustum{};
+    FrustumCull::BoxList  boxes;       // world space, one per pending entry
+    std::vector<uint8_t>  visible;
+    std::vector<Pending>  pending;     // in add() order
+    std::vector<uint32_t> visibleGroup;   // per pending entry, kLoose if not grouped
+    std::vector<Group>    groups;
+    std::unordered_map<const Mesh*, uint32_t> groupOf;
+    std::vector<DrawData> draws;       // grouped, as uploaded
+    std::vector<Command>  commands;
+    std::vector<Loose>    loose;
+    Occlusion::Culler*    occlusion = nullptr;
+    GpuCull*              gpu = nullptr;
+    GLuint                drawBuffer = 0, commandBuffer = 0;
+    size_t                drawCapacity = 0, commandCapacity = 0;
+
+    // Resident set (GPU culling), mirrored in placementBuffer/itemBuffer
+    std::vector<Resident>       residents;       // by key
+    std::vector<DrawData>       residentDraws;   // by slot
+    std::vector<GpuCull::Item>  residentItems;   // by slot; kNoCommand when free
+    MeshArena::FreeList         freeSlots;
+    std::vector<std::pair<size_t, size_t>> dirty;   // slot ranges to upload
+    std::vector<ResidentLoose>  residentLoose;
+    FrustumCull::BoxList        residentLooseBoxes;
+    std::vector<CommandSlot>    residentCommands[size_t(MeshArena::Format::Count)];
+    std::vector<uint32_t>       freeCommands[size_t(MeshArena::Format::Count)];
+    std::unordered_map<const Mesh*, uint32_t> commandOf;
+    std::vector<Command>        commandTemplate;   // instance counts 0
+    uint32_t                    commandStride = 0;
+    uint64_t                    commandsGeneration = 0;
+    size_t                      residentPlacements = 0;
+    GLuint                placementBuffer = 0, itemBuffer = 0, templateBuffer = 0;
+    GLuint                residentCommandBuffer = 0, residentDrawBuffer = 0;
+    size_t                placementCapacity = 0, itemCapacity = 0, templateCapacity = 0;
+    size_t                residentCommandCapacity = 0, residentDrawCapacity = 0;
+    bool                  residentResized = true;
+    bool                  commandsDirty = true;
+    bool                  looseChanged = false;
+
+    Stats                 stats;
+    bool                  culling = true;
+    bool                  prepared = false;
+};
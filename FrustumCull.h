@@ -0,0 +1,164 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#include <immintrin.h>
+#define FRUSTUM_CULL_AVX2 1
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define FRUSTUM_CULL_TARGET_AVX2
+#else
+#define FRUSTUM_CULL_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+// View-frustum culling of axis-aligned boxes. Boxes are kept as structure
+// of arrays so the AVX2 path tests eight against a plane per instruction;
+// CPUs without AVX2 (checked once at runtime) take the scalar loop, which
+// gives the same results.
+namespace FrustumCull {
+
+// Inward-facing planes (xyz normal, w distance) of a view-projection
+// matrix: a point p is inside plane i when dot(xyz, p) + w >= 0
+struct Frustum {
+    glm::vec4 planes[6];
+};
+
+inline Frustum extractFrustum(const glm::mat4& viewProj) {
+    const glm::mat4 m = glm::transpose(viewProj);   // rows of viewProj
+    Frustum f;
+    f.planes[0] = m[3] + m[0];   // left
+    f.planes[1] = m[3] - m[0];   // right
+    f.planes[2] = m[3] + m[1];   // bottom
+    f.planes[3] = m[3] - m[1];   // top
+    f.planes[4] = m[3] + m[2];   // near
+    f.planes[5] = m[3] - m[2];   // far
+    for (glm::vec4& p : f.planes)
+        p /= glm::length(glm::vec3(p));
+    return f;
+}
+
+// World-space box of a local box under `m` (Arvo: each output axis is the
+// sum of per-column extremes)
+inline void transformBox(const glm::mat4& m, const glm::vec3& lo, const glm::vec3& hi,
+                         glm::vec3& outLo, glm::vec3& outHi) {
+    outLo = outHi = glm::vec3(m[3]);
+    for (int c = 0; c < 3; ++c) {
+        const glm::vec3 a = glm::vec3(m[c]) * lo[c];
+        const glm::vec3 b = glm::vec3(m[c]) * hi[c];
+        outLo += glm::min(a, b);
+        outHi += glm::max(a, b);
+    }
+}
+
+inline bool hasAvx2() {
+#if !defined(FRUSTUM_CULL_AVX2)
+    return false;
+#elif defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+        return false;
+    __cpuid(info, 1);
+    const bool osxsave = (info[2] & (1 << 27)) != 0, avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6)
+        return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+// Boxes to test this frame, in add() order
+class BoxList {
+public:
+    void clear() {
+        for (auto& axis : lo) axis.clear();
+        for (auto& axis : hi) axis.clear();
+    }
+
+    void add(const glm::vec3& min, const glm::vec3& max) {
+        for (int k = 0; k < 3; ++k) {
+            lo[k].push_back(min[k]);
+            hi[k].push_back(max[k]);
+        }
+    }
+
+    size_t size() const { return lo[0].size(); }
+
+    void get(size_t i, glm::vec3& min, glm::vec3& max) const {
+        min = glm::vec3(lo[0][i], lo[1][i], lo[2][i]);
+        max = glm::vec3(hi[0][i], hi[1][i], hi[2][i]);
+    }
+
+    // visible[i] = 1 if box i intersects the frustum, else 0. Returns the
+    // number of visible boxes.
+    size_t cull(const Frustum& frustum, std::vector<uint8_t>& visible, bool allowSimd = true) const {
+        visible.assign(size(), 1);
+        size_t i = 0;
+#ifdef FRUSTUM_CULL_AVX2
+        static const bool avx2 = hasAvx2();
+        if (allowSimd && avx2)
+            i = cullAvx2(frustum, visible.data());
+#endif
+        cullScalar(frustum, visible.data(), i);
+        size_t count = 0;
+        for (uint8_t v : visible)
+            count += v;
+        return count;
+    }
+
+private:
+    // The corner furthest along a plane's normal: max on axes where the
+    // normal is positive, min elsewhere. The box is outside when even that
+    // corner is behind the plane.
+    void cullScalar(const Frustum& frustum, uint8_t* visible, size_t first) const {
+        for (size_t i = first; i < size(); ++i)
+            for (const glm::vec4& p : frustum.planes) {
+                const float d = p.x * (p.x >= 0.0f ? hi[0][i] : lo[0][i]) +
+                                p.y * (p.y >= 0.0f ? hi[1][i] : lo[1][i]) +
+                                p.z * (p.z >= 0.0f ? hi[2][i] : lo[2][i]) + p.w;
+                if (d < 0.0f) {
+                    visible[i] = 0;
+                    break;
+                }
+            }
+    }
+
+#ifdef FRUSTUM_CULL_AVX2
+    // Eight boxes per iteration; returns the first box left for the
+    // scalar tail
+    FRUSTUM_CULL_TARGET_AVX2 size_t cullAvx2(const Frustum& frustum, uint8_t* visible) const {
+        const size_t n = size() & ~size_t(7);
+        const __m256 zero = _mm256_setzero_ps();
+        for (size_t i = 0; i < n; i += 8) {
+            __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+            for (const glm::vec4& p : frustum.planes) {
+                const float* x = p.x >= 0.0f ? hi[0].data() : lo[0].data();
+                const float* y = p.y >= 0.0f ? hi[1].data() : lo[1].data();
+                const float* z = p.z >= 0.0f ? hi[2].data() : lo[2].data();
+                __m256 d = _mm256_add_ps(
+                    _mm256_mul_ps(_mm256_set1_ps(p.x), _mm256_loadu_ps(x + i)),
+                    _mm256_mul_ps(_mm256_set1_ps(p.y), _mm256_loadu_ps(y + i)));
+                d = _mm256_add_ps(d, _mm256_mul_ps(_mm256_set1_ps(p.z), _mm256_loadu_ps(z + i)));
+                d = _mm256_add_ps(d, _mm256_set1_ps(p.w));
+                inside = _mm256_and_ps(inside, _mm256_cmp_ps(d, zero, _CMP_NLT_UQ));
+            }
+            const int mask = _mm256_movemask_ps(inside);
+            for (int k = 0; k < 8; ++k)
+                visible[i + k] = uint8_t((mask >> k) & 1);
+        }
+        return n;
+    }
+#endif
+
+    std::vector<float> lo[3], hi[3];   // per axis
+};
+
+} // namespace FrustumCull
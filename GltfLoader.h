@@ -0,0 +1,276 @@
+#pragma once
+
+#include <cctype>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "AssetPack.h"
+#include "Json.h"
+#include "MappedFile.h"
+
+// Fast path for glTF 2.0 (.gltf + external .bin): the JSON is parsed once,
+// the .bin buffers are mapped, and every bufferView a draw needs is later
+// uploaded as-is into its own GL buffer. Primitives reference those buffers
+// by offset and stride, so nothing is repacked and no aiScene is built.
+//
+// Anything outside the common subset (data: URIs, .glb, sparse accessors,
+// missing normals, skins/morph targets, animations, required extensions) makes
+// Gltf::load() return false and the caller falls back to Assimp.
+namespace Gltf {
+
+// glTF component types (same values as the GL enums)
+constexpr unsigned kUnsignedByte  = 5121;
+constexpr unsigned kUnsignedShort = 5123;
+constexpr unsigned kUnsignedInt   = 5125;
+constexpr unsigned kFloat         = 5126;
+
+struct BufferView {
+    const unsigned char* data = nullptr;
+    size_t               size = 0;
+    bool                 used = false;
+};
+
+// One drawable primitive instanced by one node
+struct Primitive {
+    int       positionView = -1;
+    size_t    positionOffset = 0;
+    unsigned  positionStride = 0;
+    int       normalView = -1;
+    size_t    normalOffset = 0;
+    unsigned  normalStride = 0;
+    int       indexView = -1;
+    size_t    indexOffset = 0;
+    unsigned  indexType = kUnsignedInt;
+    size_t    vertexCount = 0;
+    size_t    indexCount = 0;
+    glm::mat4 transform = glm::mat4(1.0f);   // node world transform
+};
+
+struct Asset {
+    std::vector<MappedFile> buffers;
+    std::vector<BufferView> views;
+    std::vector<Primitive>  primitives;
+};
+
+inline bool isGltfPath(const std::string& path) {
+    std::string ext = std::filesystem::path(path).extension().string();
+    for (auto& c : ext)
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    return ext == ".gltf";
+}
+
+inline size_t componentSize(unsigned type) {
+    switch (type) {
+    case kUnsignedByte:  return 1;
+    case kUnsignedShort: return 2;
+    case kUnsignedInt:   return 4;
+    case kFloat:         return 4;
+    }
+    return 0;
+}
+
+inline glm::mat4 nodeLocalTransform(const JsonValue& node) {
+    const JsonValue* m = node.find("matrix");
+    if (m && m->isArray() && m->array.size() == 16) {
+        float f[16];
+        for (int i = 0; i < 16; ++i)
+            f[i] = static_cast<float>(m->array[i].number);
+        return glm::make_mat4(f); // glTF matrices are column-major like glm
+    }
+    glm::vec3 t(0.0f), s(1.0f);
+    glm::quat r(1.0f, 0.0f, 0.0f, 0.0f);
+    if (const JsonValue* v = node.find("translation"); v && v->array.size() == 3)
+        t = { v->array[0].number, v->array[1].number, v->array[2].number };
+    if (const JsonValue* v = node.find("rotation"); v && v->array.size() == 4)
+        r = glm::quat(float(v->array[3].number), float(v->array[0].number),
+                      float(v->array[1].number), float(v->array[2].number));
+    if (const JsonValue* v = node.find("scale"); v && v->array.size() == 3)
+        s = { v->array[0].number, v->array[1].number, v->array[2].number };
+    return glm::translate(glm::mat4(1.0f), t) * glm::mat4_cast(r) * glm::scale(glm::mat4(1.0f), s);
+}
+
+struct AccessorRef {
+    int      view = -1;
+    size_t   offset = 0;      // byte offset inside the view
+    unsigned stride = 0;
+    unsigned component = 0;
+    size_t   count = 0;
+};
+
+class Parser {
+public:
+    Parser(const JsonValue& doc, Asset& asset) : doc(doc), asset(asset) {}
+
+    // Resolves an accessor into its view, offset and stride. A zero
+    // wantComponent accepts any integer type (index accessors). The whole
+    // element range must lie inside the view.
+    bool accessor(long long index, unsigned wantComponent, const char* wantType,
+                  unsigned components, AccessorRef& out) const {
+        const JsonValue* accessors = doc.find("accessors");
+        const JsonValue* views = doc.find("bufferViews");
+        if (!accessors || !views || index < 0 || size_t(index) >= accessors->array.size())
+            return false;
+        const JsonValue& acc = accessors->array[size_t(index)];
+        if (acc.find("sparse") || !acc.find("bufferView"))
+            return false;
+        const JsonValue* normalized = acc.find("normalized");
+        if (normalized && normalized->boolean)
+            return false;
+        out.component = static_cast<unsigned>(acc.getInt("componentType", 0));
+        if (wantComponent ? out.component != wantComponent
+                          : (out.component == kFloat || componentSize(out.component) == 0))
+            return false;
+        if (acc.getString("type") != wantType)
+            return false;
+
+        long long v = acc.getInt("bufferView", -1);
+        if (v < 0 || size_t(v) >= views->array.size() || size_t(v) >= asset.views.size())
+            return false;
+        const JsonValue& bv = views->array[size_t(v)];
+        const size_t elementSize = componentSize(out.component) * components;
+        out.view = static_cast<int>(v);
+        out.count = static_cast<size_t>(acc.getInt("count", 0));
+        out.offset = static_cast<size_t>(acc.getInt("byteOffset", 0));
+        out.stride = static_cast<unsigned>(bv.getInt("byteStride", 0));
+        if (out.stride == 0)
+            out.stride = static_cast<unsigned>(elementSize);
+        return out.count != 0 && out.offset % componentSize(out.component) == 0 &&
+            out.offset + size_t(out.stride) * (out.count - 1) + elementSize <= asset.views[out.view].size;
+    }
+
+    bool primitive(const JsonValue& prim, const glm::mat4& world) {
+        // Only triangles are drawn; points and lines are skipped, as the
+        // Assimp profiles drop them too
+        if (prim.getInt("mode", 4) != 4)
+            return true;
+        const JsonValue* attrs = prim.find("attributes");
+        if (!attrs)
+            return false;
+        AccessorRef pos, nrm, idx;
+        if (!accessor(attrs->getInt("POSITION", -1), kFloat, "VEC3", 3, pos) ||
+            !accessor(attrs->getInt("NORMAL", -1), kFloat, "VEC3", 3, nrm) ||
+            !accessor(prim.getInt("indices", -1), 0, "SCALAR", 1, idx) ||
+            nrm.count != pos.count ||
+            idx.stride != componentSize(idx.component)) // indices must be tightly packed
+            return false;
+
+        Primitive p;
+        p.transform = world;
+        p.positionView = pos.view;
+        p.positionOffset = pos.offset;
+        p.positionStride = pos.stride;
+        p.normalView = nrm.view;
+        p.normalOffset = nrm.offset;
+        p.normalStride = nrm.stride;
+        p.indexView = idx.view;
+        p.indexOffset = idx.offset;
+        p.indexType = idx.component;
+        p.vertexCount = pos.count;
+        p.indexCount = idx.count;
+        asset.views[pos.view].used = true;
+        asset.views[nrm.view].used = true;
+        asset.views[idx.view].used = true;
+        asset.primitives.push_back(p);
+        return true;
+    }
+
+    bool node(long long index, const glm::mat4& parent, int depth) {
+        const JsonValue* nodes = doc.find("nodes");
+        if (!nodes || index < 0 || size_t(index) >= nodes->array.size() || depth > 64)
+            return false;
+        const JsonValue& n = nodes->array[size_t(index)];
+        if (n.find("skin") || n.find("weights"))
+            return false;
+        glm::mat4 world = parent * nodeLocalTransform(n);
+        long long meshIndex = n.getInt("mesh", -1);
+        if (meshIndex >= 0) {
+            const JsonValue* meshes = doc.find("meshes");
+            if (!meshes || size_t(meshIndex) >= meshes->array.size())
+                return false;
+            const JsonValue* prims = meshes->array[size_t(meshIndex)].find("primitives");
+            if (!prims)
+                return false;
+            for (const auto& prim : prims->array)
+                if (!primitive(prim, world))
+                    return false;
+        }
+        if (const JsonValue* children = n.find("children"))
+            for (const auto& c : children->array)
+                if (!node(static_cast<long long>(c.number), world, depth + 1))
+                    return false;
+        return true;
+    }
+
+private:
+    const JsonValue& doc;
+    Asset&           asset;
+};
+
+// CPU phase: parse the .gltf, map its buffers (loose or from a mounted
+// pack) and resolve every primitive. Returns false if the file is not in the
+// supported subset.
+inline bool load(const std::string& path, Asset& asset) {
+    MappedFile text;
+    if (!AssetFiles::open(path, text))
+        return false;
+    JsonValue doc;
+    std::string error;
+    if (!JsonParser::parse(reinterpret_cast<const char*>(text.data()), text.size(), doc, error))
+        return false;
+    if (const JsonValue* required = doc.find("extensionsRequired"); required && !required->array.empty())
+        return false;
+    // Animated nodes need the hierarchy, which only the Assimp path keeps
+    if (const JsonValue* animations = doc.find("animations"); animations && !animations->array.empty())
+        return false;
+
+    // Buffers: external files only
+    const std::filesystem::path dir = std::filesystem::path(path).parent_path();
+    const JsonValue* buffers = doc.find("buffers");
+    if (!buffers)
+        return false;
+    for (const auto& b : buffers->array) {
+        std::string uri = b.getString("uri");
+        if (uri.empty() || uri.compare(0, 5, "data:") == 0 || uri.find('%') != std::string::npos)
+            return false;
+        MappedFile file;
+        if (!AssetFiles::open((dir / uri).string(), file) || file.size() < size_t(b.getInt("byteLength", 0)))
+            return false;
+        asset.buffers.push_back(std::move(file));
+    }
+
+    const JsonValue* views = doc.find("bufferViews");
+    if (!views)
+        return false;
+    for (const auto& v : views->array) {
+        long long buffer = v.getInt("buffer", -1);
+        size_t offset = static_cast<size_t>(v.getInt("byteOffset", 0));
+        size_t length = static_cast<size_t>(v.getInt("byteLength", 0));
+        if (buffer < 0 || size_t(buffer) >= asset.buffers.size() ||
+            offset + length > asset.buffers[size_t(buffer)].size())
+            return false;
+        asset.views.push_back({ asset.buffers[size_t(buffer)].data() + offset, length, false });
+    }
+
+    // Walk the default scene (or every root if none is given)
+    Parser parser(doc, asset);
+    const JsonValue* scenes = doc.find("scenes");
+    long long sceneIndex = doc.getInt("scene", 0);
+    if (!scenes || sceneIndex < 0 || size_t(sceneIndex) >= scenes->array.size())
+        return false;
+    const JsonValue* roots = scenes->array[size_t(sceneIndex)].find("nodes");
+    if (!roots)
+        return false;
+    for (const auto& r : roots->array)
+        if (!parser.node(static_cast<long long>(r.number), glm::mat4(1.0f), 0))
+            return false;
+    return !asset.primitives.empty();
+}
+
+} // namespace Gltf
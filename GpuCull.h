@@ -0,0 +1,158 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "FrustumCull.h"
+#include "GpuMemory.h"
+
+// GPU side of DrawBatch's culling. A compute shader reads one Item (world
+// box and command index) per placement, tests it against the frustum and
+// against a Hi-Z pyramid of the previous frame's depth, and appends the
+// survivors' DrawData to their command: instanceCount is bumped with an
+// atomic and the entry lands at baseInstance + slot. The commands stay in
+// place, empty ones with instanceCount 0, since GL 4.3 has no
+// glMultiDrawElementsIndirectCount; everything else stays on the GPU.
+//
+// The pyramid is built at the end of a frame by captureDepth(): the default
+// framebuffer's depth is copied out, then halved level by level keeping the
+// farthest depth. Boxes are projected with that frame's view-projection, so
+// a static box is only hidden by what really covered it. The programs come
+// from the renderer (see the cull/reduce compute shaders in main.cpp).
+// Context thread only.
+class GpuCull {
+public:
+    // Storage bindings next to DrawBatch::kDrawDataBinding (the output)
+    static constexpr GLuint kPlacementBinding = 1;
+    static constexpr GLuint kItemBinding      = 2;
+    static constexpr GLuint kCommandBinding   = 3;
+    static constexpr GLuint kLocalSize        = 64;   // cull shader's local_size_x
+
+    // Matches the std430 Item struct in the cull shader
+    struct Item {
+        glm::vec3 lo;
+        uint32_t  command;
+        glm::vec3 hi;
+        uint32_t  pad;
+    };
+    static_assert(sizeof(Item) == 32, "Item must match the std430 layout");
+
+    GpuCull(GLuint cullProgram, GLuint reduceProgram) : cullProgram(cullProgram), reduceProgram(reduceProgram) {}
+    ~GpuCull() { release(); }
+
+    GpuCull(const GpuCull&) = delete;
+    GpuCull& operator=(const GpuCull&) = delete;
+
+    void setHiZ(bool on) { hiZEnabled = on; }
+    bool hasHiZ() const  { return hiZValid && hiZEnabled; }
+
+    // Culls `count` items with the buffers bound at the bindings above and
+    // the output at DrawBatch::kDrawDataBinding. With `test` off every item
+    // is kept (the commands are still filled in).
+    void cull(const FrustumCull::Frustum& frustum, size_t count, bool test) {
+        if (!count)
+            return;
+        GLint previous = 0;
+        glGetIntegerv(GL_CURRENT_PROGRAM, &previous);
+        glUseProgram(cullProgram);
+        glUniform1ui(glGetUniformLocation(cullProgram, "itemCount"), GLuint(count));
+        glUniform4fv(glGetUniformLocation(cullProgram, "planes"), 6, glm::value_ptr(frustum.planes[0]));
+        glUniform1i(glGetUniformLocation(cullProgram, "frustumTest"), test);
+        glUniform1i(glGetUniformLocation(cullProgram, "hiZTest"), test && hasHiZ());
+        if (test && hasHiZ()) {
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, hiZTexture);
+            glUniform1i(glGetUniformLocation(cullProgram, "hiZ"), 0);
+            glUniformMatrix4fv(glGetUniformLocation(cullProgram, "hiZViewProj"), 1, GL_FALSE,
+                glm::value_ptr(hiZViewProj));
+            glUniform2f(glGetUniformLocation(cullProgram, "hiZSize"), float(width), float(height));
+            glUniform1i(glGetUniformLocation(cullProgram, "hiZLevels"), levels);
+        }
+        glDispatchCompute(GLuint((count + kLocalSize - 1) / kLocalSize), 1, 1);
+        // The draws read the commands and the compacted DrawData next
+        glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glUseProgram(GLuint(previous));
+    }
+
+    // End of frame, before the swap: rebuilds the pyramid from the default
+    // framebuffer's depth, rendered with `viewProj` at width x height
+    void captureDepth(int w, int h, const glm::mat4& viewProj) {
+        if (w <= 0 || h <= 0 || !hiZEnabled) {
+            hiZValid = false;
+            return;
+        }
+        if (w != width || h != height)
+            resize(w, h);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, depthTexture);
+        glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, w, h);
+
+        GLint previous = 0;
+        glGetIntegerv(GL_CURRENT_PROGRAM, &previous);
+        glUseProgram(reduceProgram);
+        glUniform1i(glGetUniformLocation(reduceProgram, "source"), 0);
+        for (int level = 0; level < levels; ++level) {
+            // Level 0 copies the depth texture, the rest halve the one below
+            glBindTexture(GL_TEXTURE_2D, level ? hiZTexture : depthTexture);
+            glUniform1i(glGetUniformLocation(reduceProgram, "sourceLevel"), std::max(0, level - 1));
+            glUniform1i(glGetUniformLocation(reduceProgram, "downsample"), level > 0);
+            glBindImageTexture(0, hiZTexture, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+            const int lw = std::max(1, w >> level), lh = std::max(1, h >> level);
+            glDispatchCompute(GLuint((lw + 7) / 8), GLuint((lh + 7) / 8), 1);
+            glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+        }
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glUseProgram(GLuint(previous));
+        hiZViewProj = viewProj;
+        hiZValid = true;
+    }
+
+    // Forget the pyramid (a frame was drawn without capturing it)
+    void invalidate() { hiZValid = false; }
+
+    void release() {
+        GpuMemory::deleteTexture(depthTexture, GpuMemory::Kind::Target);
+        GpuMemory::deleteTexture(hiZTexture, GpuMemory::Kind::Target);
+        width = height = levels = 0;
+        hiZValid = false;
+    }
+
+private:
+    void resize(int w, int h) {
+        release();
+        width = w;
+        height = h;
+        levels = 1 + int(std::floor(std::log2(float(std::max(w, h)))));
+
+        glGenTextures(1, &depthTexture);
+        glBindTexture(GL_TEXTURE_2D, depthTexture);
+        glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT24, w, h);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_NONE);
+
+        glGenTextures(1, &hiZTexture);
+        glBindTexture(GL_TEXTURE_2D, hiZTexture);
+        glTexStorage2D(GL_TEXTURE_2D, levels, GL_R32F, w, h);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        GpuMemory::track(GpuMemory::Kind::Target, depthTexture, size_t(w) * h * 4);
+        GpuMemory::track(GpuMemory::Kind::Target, hiZTexture, size_t(w) * h * 4 * 4 / 3);
+    }
+
+    GLuint    cullProgram, reduceProgram;
+    GLuint    depthTexture = 0, hiZTexture = 0;
+    int       width = 0, height = 0, levels = 0;
+    glm::mat4 hiZViewProj{ 1.0f };
+    bool      hiZEnabled = true;
+    bool      hiZValid = false;
+};
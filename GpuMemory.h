@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <ostream>
+#include <unordered_map>
+
+#include <glad/glad.h>
+
+// Bytes held in GL buffers and textures, per object. Every allocation path
+// (createStaticBuffer, the upload ring, render targets) records its objects
+// here and deletes them through deleteBuffer()/deleteTexture(), so totals
+// always match what is live. Context thread only, like the objects.
+namespace GpuMemory {
+
+// Target: textures the renderer draws or copies into (not assets)
+enum class Kind { Buffer, Staging, Target, Count };
+
+struct Ledger {
+    std::unordered_map<GLuint, size_t> objects[size_t(Kind::Count)];
+    size_t                             bytes[size_t(Kind::Count)] = {};
+};
+
+inline Ledger& ledger() {
+    static Ledger l;
+    return l;
+}
+
+inline void track(Kind kind, GLuint id, size_t bytes) {
+    if (!id)
+        return;
+    Ledger& l = ledger();
+    size_t& slot = l.objects[size_t(kind)][id];
+    l.bytes[size_t(kind)] += bytes - slot;
+    slot = bytes;
+}
+
+inline void untrack(Kind kind, GLuint id) {
+    Ledger& l = ledger();
+    auto it = l.objects[size_t(kind)].find(id);
+    if (it == l.objects[size_t(kind)].end())
+        return;
+    l.bytes[size_t(kind)] -= it->second;
+    l.objects[size_t(kind)].erase(it);
+}
+
+inline size_t bytesOf(Kind kind, GLuint id) {
+    const auto& objects = ledger().objects[size_t(kind)];
+    auto it = objects.find(id);
+    return it == objects.end() ? 0 : it->second;
+}
+
+inline void deleteBuffer(GLuint& id, Kind kind = Kind::Buffer) {
+    if (!id)
+        return;
+    untrack(kind, id);
+    glDeleteBuffers(1, &id);
+    id = 0;
+}
+
+inline void deleteTexture(GLuint& id, Kind kind = Kind::Target) {
+    if (!id)
+        return;
+    untrack(kind, id);
+    glDeleteTextures(1, &id);
+    id = 0;
+}
+
+inline size_t bytes(Kind kind) { return ledger().bytes[size_t(kind)]; }
+inline size_t count(Kind kind) { return ledger().objects[size_t(kind)].size(); }
+
+// Asset memory: mesh buffers, the arenas at their capacity. The staging
+// ring is a fixed allocation and not part of any asset.
+inline size_t assetBytes() { return bytes(Kind::Buffer); }
+
+inline void print(std::ostream& out) {
+    const double mb = 1.0 / (1024.0 * 1024.0);
+    out << "  GPU: " << bytes(Kind::Buffer) * mb << " MB in " << count(Kind::Buffer) << " buffers, "
+        << bytes(Kind::Staging) * mb << " MB staging, " << bytes(Kind::Target) * mb << " MB render targets\n";
+}
+
+} // namespace GpuMemory
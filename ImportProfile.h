@@ -0,0 +1,81 @@
+#pragma once
+
+#include <string>
+
+#include <assimp/Importer.hpp>
+#include <assimp/config.h>
+#include <assimp/mesh.h>
+#include <assimp/postprocess.h>
+
+// Named Assimp post-processing setups. The shaders only read position and
+// normal, so texture coordinates, tangents and colors are stripped before
+// welding; otherwise seams in unused channels keep vertices apart.
+enum class ImportProfile {
+    FastLoad,        // least import work: triangulate, fill in missing normals
+    RenderOptimized, // welded, cache-ordered, merged meshes: fewer vertices and draws
+    Physics          // welded triangles without normals, CPU geometry kept
+};
+
+inline const char* profileName(ImportProfile profile) {
+    switch (profile) {
+    case ImportProfile::FastLoad:        return "fast-load";
+    case ImportProfile::RenderOptimized: return "render-optimized";
+    case ImportProfile::Physics:         return "physics";
+    }
+    return "?";
+}
+
+inline bool parseProfile(const std::string& name, ImportProfile& out) {
+    for (ImportProfile p : { ImportProfile::FastLoad, ImportProfile::RenderOptimized, ImportProfile::Physics }) {
+        if (name == profileName(p)) {
+            out = p;
+            return true;
+        }
+    }
+    return false;
+}
+
+inline unsigned int importFlagsFor(ImportProfile profile) {
+    switch (profile) {
+    case ImportProfile::FastLoad:
+        return aiProcess_Triangulate |
+            aiProcess_GenNormals;
+    case ImportProfile::RenderOptimized:
+        return aiProcess_Triangulate |
+            aiProcess_GenNormals |
+            aiProcess_RemoveComponent |
+            aiProcess_JoinIdenticalVertices |
+            aiProcess_FindDegenerates |
+            aiProcess_SortByPType |
+            aiProcess_RemoveRedundantMaterials |
+            aiProcess_OptimizeMeshes |
+            aiProcess_OptimizeGraph |
+            aiProcess_ImproveCacheLocality;
+    case ImportProfile::Physics:
+        return aiProcess_Triangulate |
+            aiProcess_RemoveComponent |
+            aiProcess_JoinIdenticalVertices |
+            aiProcess_FindDegenerates |
+            aiProcess_SortByPType |
+            aiProcess_OptimizeMeshes |
+            aiProcess_OptimizeGraph;
+    }
+    return aiProcess_Triangulate;
+}
+
+// Physics wants the geometry on the CPU; everything else drops it after upload
+inline bool profileKeepsCpuGeometry(ImportProfile profile) {
+    return profile == ImportProfile::Physics;
+}
+
+// Importer properties that go with the profile's flags. Set on every import
+// because one importer per worker thread serves all profiles.
+inline void configureImporter(Assimp::Importer& importer, ImportProfile profile) {
+    int removed = aiComponent_TEXCOORDS | aiComponent_TANGENTS_AND_BITANGENTS | aiComponent_COLORS;
+    if (profile == ImportProfile::Physics)
+        removed |= aiComponent_NORMALS;
+    importer.SetPropertyInteger(AI_CONFIG_PP_RVC_FLAGS, removed);
+    // Only triangles are drawn: drop point/line primitives and degenerates
+    importer.SetPropertyInteger(AI_CONFIG_PP_SBP_REMOVE, aiPrimitiveType_POINT | aiPrimitiveType_LINE);
+    importer.SetPropertyBool(AI_CONFIG_PP_FD_REMOVE, true);
+}
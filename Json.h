@@ -0,0 +1,279 @@
+#pragma once
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Minimal JSON DOM, enough for glTF and the asset tools. Numbers are kept
+// as double; object members keep their file order.
+struct JsonValue {
+    enum class Type { Null, Bool, Number, String, Array, Object };
+
+    Type                                           type = Type::Null;
+    bool                                           boolean = false;
+    double                                         number = 0.0;
+    std::string                                    string;
+    std::vector<JsonValue>                         array;
+    std::vector<std::pair<std::string, JsonValue>> object;
+
+    bool isNull()   const { return type == Type::Null; }
+    bool isNumber() const { return type == Type::Number; }
+    bool isString() const { return type == Type::String; }
+    bool isArray()  const { return type == Type::Array; }
+    bool isObject() const { return type == Type::Object; }
+
+    // Member lookup; null if this is not an object or has no such key
+    const JsonValue* find(const char* key) const {
+        if (type != Type::Object)
+            return nullptr;
+        for (const auto& m : object)
+            if (m.first == key)
+                return &m.second;
+        return nullptr;
+    }
+
+    // Convenience accessors with defaults for missing or mistyped members
+    double getNumber(const char* key, double fallback) const {
+        const JsonValue* v = find(key);
+        return v && v->isNumber() ? v->number : fallback;
+    }
+    long long getInt(const char* key, long long fallback) const {
+        const JsonValue* v = find(key);
+        return v && v->isNumber() ? static_cast<long long>(v->number) : fallback;
+    }
+    std::string getString(const char* key, const std::string& fallback = "") const {
+        const JsonValue* v = find(key);
+        return v && v->isString() ? v->string : fallback;
+    }
+};
+
+class JsonParser {
+public:
+    // Parses the whole text; on failure returns false and sets `error`
+    static bool parse(const char* text, size_t length, JsonValue& out, std::string& error) {
+        JsonParser p(text, text + length);
+        p.skipSpace();
+        if (!p.parseValue(out, 0)) {
+            error = p.error + " at offset " + std::to_string(p.cur - text);
+            return false;
+        }
+        p.skipSpace();
+        if (p.cur != p.end) {
+            error = "trailing characters at offset " + std::to_string(p.cur - text);
+            return false;
+        }
+        return true;
+    }
+
+private:
+    JsonParser(const char* begin, const char* end) : cur(begin), end(end) {}
+
+    static constexpr int kMaxDepth = 256;
+
+    const char* cur;
+    const char* end;
+    std::string error;
+
+    bool fail(const char* msg) {
+        error = msg;
+        return false;
+    }
+
+    void skipSpace() {
+        while (cur != end && (*cur == ' ' || *cur == '\t' || *cur == '\n' || *cur == '\r'))
+            ++cur;
+    }
+
+    bool literal(const char* word) {
+        size_t n = std::strlen(word);
+        if (size_t(end - cur) < n || std::strncmp(cur, word, n) != 0)
+            return fail("invalid literal");
+        cur += n;
+        return true;
+    }
+
+    bool parseValue(JsonValue& v, int depth) {
+        if (depth > kMaxDepth)
+            return fail("nesting too deep");
+        if (cur == end)
+            return fail("unexpected end of input");
+        switch (*cur) {
+        case '{': return parseObject(v, depth);
+        case '[': return parseArray(v, depth);
+        case '"': v.type = JsonValue::Type::String; return parseString(v.string);
+        case 't': v.type = JsonValue::Type::Bool; v.boolean = true;  return literal("true");
+        case 'f': v.type = JsonValue::Type::Bool; v.boolean = false; return literal("false");
+        case 'n': v.type = JsonValue::Type::Null; return literal("null");
+        default:  return parseNumber(v);
+        }
+    }
+
+    bool parseNumber(JsonValue& v) {
+        // strtod needs a terminated buffer; numbers are short, copy them out
+        const char* start = cur;
+        while (cur != end && (std::strchr("+-.eE", *cur) || (*cur >= '0' && *cur <= '9')))
+            ++cur;
+        if (cur == start)
+            return fail("unexpected character");
+        std::string tmp(start, cur);
+        char* stop = nullptr;
+        v.type = JsonValue::Type::Number;
+        v.number = std::strtod(tmp.c_str(), &stop);
+        if (stop != tmp.c_str() + tmp.size())
+            return fail("invalid number");
+        return true;
+    }
+
+    static void appendUtf8(std::string& s, unsigned cp) {
+        if (cp < 0x80) {
+            s += char(cp);
+        }
+        else if (cp < 0x800) {
+            s += char(0xC0 | (cp >> 6));
+            s += char(0x80 | (cp & 0x3F));
+        }
+        else if (cp < 0x10000) {
+            s += char(0xE0 | (cp >> 12));
+            s += char(0x80 | ((cp >> 6) & 0x3F));
+            s += char(0x80 | (cp & 0x3F));
+        }
+        else {
+            s += char(0xF0 | (cp >> 18));
+            s += char(0x80 | ((cp >> 12) & 0x3F));
+            s += char(0x80 | ((cp >> 6) & 0x3F));
+            s += char(0x80 | (cp & 0x3F));
+        }
+    }
+
+    bool parseHex4(unsigned& cp) {
+        if (end - cur < 4)
+            return fail("truncated \\u escape");
+        cp = 0;
+        for (int i = 0; i < 4; ++i, ++cur) {
+            char c = *cur;
+            cp <<= 4;
+            if (c >= '0' && c <= '9')      cp |= unsigned(c - '0');
+            else if (c >= 'a' && c <= 'f') cp |= unsigned(c - 'a' + 10);
+            else if (c >= 'A' && c <= 'F') cp |= unsigned(c - 'A' + 10);
+            else return fail("invalid \\u escape");
+        }
+        return true;
+    }
+
+    bool parseString(std::string& s) {
+        ++cur; // opening quote
+        while (cur != end && *cur != '"') {
+            if (*cur != '\\') {
+                s += *cur++;
+                continue;
+            }
+            if (++cur == end)
+                return fail("unterminated string");
+            char c = *cur++;
+            switch (c) {
+            case '"': case '\\': case '/': s += c; break;
+            case 'b': s += '\b'; break;
+            case 'f': s += '\f'; break;
+            case 'n': s += '\n'; break;
+            case 'r': s += '\r'; break;
+            case 't': s += '\t'; break;
+            case 'u': {
+                unsigned cp;
+                if (!parseHex4(cp))
+                    return false;
+                // A high surrogate must be followed by a low one; neither
+                // may stand alone (UTF-8 cannot encode them)
+                if (cp >= 0xDC00 && cp <= 0xDFFF)
+                    return fail("invalid surrogate");
+                if (cp >= 0xD800 && cp < 0xDC00) {
+                    if (end - cur < 6 || cur[0] != '\\' || cur[1] != 'u')
+                        return fail("invalid surrogate");
+                    cur += 2;
+                    unsigned lo;
+                    if (!parseHex4(lo))
+                        return false;
+                    if (lo < 0xDC00 || lo > 0xDFFF)
+                        return fail("invalid surrogate");
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+                }
+                appendUtf8(s, cp);
+                break;
+            }
+            default:
+                return fail("invalid escape");
+            }
+        }
+        if (cur == end)
+            return fail("unterminated string");
+        ++cur; // closing quote
+        return true;
+    }
+
+    bool parseArray(JsonValue& v, int depth) {
+        v.type = JsonValue::Type::Array;
+        ++cur;
+        skipSpace();
+        if (cur != end && *cur == ']') {
+            ++cur;
+            return true;
+        }
+        while (true) {
+            v.array.emplace_back();
+            skipSpace();
+            if (!parseValue(v.array.back(), depth + 1))
+                return false;
+            skipSpace();
+            if (cur == end)
+                return fail("unterminated array");
+            if (*cur == ',') {
+                ++cur;
+                continue;
+            }
+            if (*cur == ']') {
+                ++cur;
+                return true;
+            }
+            return fail("expected ',' or ']'");
+        }
+    }
+
+    bool parseObject(JsonValue& v, int depth) {
+        v.type = JsonValue::Type::Object;
+        ++cur;
+        skipSpace();
+        if (cur != end && *cur == '}') {
+            ++cur;
+            return true;
+        }
+        while (true) {
+            skipSpace();
+            if (cur == end || *cur != '"')
+                return fail("expected member name");
+            std::string key;
+            if (!parseString(key))
+                return false;
+            skipSpace();
+            if (cur == end || *cur != ':')
+                return fail("expected ':'");
+            ++cur;
+            skipSpace();
+            v.object.emplace_back(std::move(key), JsonValue());
+            if (!parseValue(v.object.back().second, depth + 1))
+                return false;
+            skipSpace();
+            if (cur == end)
+                return fail("unterminated object");
+            if (*cur == ',') {
+                ++cur;
+                continue;
+            }
+            if (*cur == '}') {
+                ++cur;
+                return true;
+            }
+            return fail("expected ',' or '}'");
+        }
+    }
+};
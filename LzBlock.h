@@ -0,0 +1,161 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Byte-oriented LZ77 block codec in the LZ4 block format: sequences of
+// [token | literal length ext | literals | 16-bit offset | match length ext].
+// The encoder is a greedy single-probe hash matcher, fast rather than
+// tight. The decoder copies literals and non-overlapping matches in 16-byte
+// chunks, which compilers turn into unaligned vector loads/stores.
+namespace LzBlock {
+
+constexpr size_t kMinMatch     = 4;
+constexpr size_t kLastLiterals = 5;   // the block always ends in literals
+constexpr size_t kMatchLimit   = 12;  // no match may start after n - 12
+constexpr size_t kMaxOffset    = 65535;
+constexpr int    kHashBits     = 16;
+
+inline size_t compressBound(size_t n) { return n + n / 255 + 16; }
+
+inline uint32_t read32(const unsigned char* p) {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline uint32_t hash4(uint32_t v) { return (v * 2654435761u) >> (32 - kHashBits); }
+
+// Compresses `n` bytes into `dst`. Returns the compressed size, or 0 if the
+// output would not fit in `capacity` or there is nothing to compress
+// (store the data instead).
+inline size_t compress(const unsigned char* src, size_t n, unsigned char* dst, size_t capacity) {
+    if (n == 0)
+        return 0;
+    unsigned char* op = dst;
+    unsigned char* const oend = dst + capacity;
+
+    auto writeLength = [&](size_t len) {
+        for (; len >= 255; len -= 255) {
+            if (op == oend)
+                return false;
+            *op++ = 255;
+        }
+        if (op == oend)
+            return false;
+        *op++ = static_cast<unsigned char>(len);
+        return true;
+    };
+    auto emit = [&](const unsigned char* literals, size_t litLen, size_t offset, size_t matchLen) {
+        const size_t need = 1 + litLen + litLen / 255 + 2 + (matchLen ? matchLen / 255 + 1 : 0);
+        if (size_t(oend - op) < need)
+            return false;
+        const size_t m = matchLen ? matchLen - kMinMatch : 0;
+        *op++ = static_cast<unsigned char>(((litLen < 15 ? litLen : 15) << 4) | (m < 15 ? m : 15));
+        if (litLen >= 15 && !writeLength(litLen - 15))
+            return false;
+        std::memcpy(op, literals, litLen);
+        op += litLen;
+        if (!matchLen)
+            return true;
+        *op++ = static_cast<unsigned char>(offset & 0xFF);
+        *op++ = static_cast<unsigned char>(offset >> 8);
+        return m < 15 || writeLength(m - 15);
+    };
+
+    size_t anchor = 0;
+    if (n > kMatchLimit) {
+        std::vector<uint32_t> table(size_t(1) << kHashBits, 0);
+        const size_t matchEnd = n - kLastLiterals;
+        size_t ip = 1;
+        while (ip < n - kMatchLimit) {
+            const uint32_t seq = read32(src + ip);
+            const uint32_t h = hash4(seq);
+            const size_t candidate = table[h];
+            table[h] = static_cast<uint32_t>(ip);
+            if (ip - candidate > kMaxOffset || read32(src + candidate) != seq) {
+                ++ip;
+                continue;
+            }
+            size_t len = kMinMatch;
+            while (ip + len < matchEnd && src[candidate + len] == src[ip + len])
+                ++len;
+            if (!emit(src + anchor, ip - anchor, ip - candidate, len))
+                return 0;
+            ip += len;
+            anchor = ip;
+        }
+    }
+    if (!emit(src + anchor, n - anchor, 0, 0))
+        return 0;
+    return static_cast<size_t>(op - dst);
+}
+
+// Decompresses a block into exactly `n` bytes at `dst`. Returns false on
+// malformed or truncated input; never reads or writes out of bounds.
+inline bool decompress(const unsigned char* src, size_t srcSize, unsigned char* dst, size_t n) {
+    const unsigned char* ip = src;
+    const unsigned char* const iend = src + srcSize;
+    unsigned char* op = dst;
+    unsigned char* const oend = dst + n;
+
+    auto readLength = [&](size_t& len) {
+        unsigned char b;
+        do {
+            if (ip == iend)
+                return false;
+            b = *ip++;
+            len += b;
+        } while (b == 255);
+        return true;
+    };
+
+    while (ip < iend) {
+        const unsigned token = *ip++;
+        size_t litLen = token >> 4;
+        if (litLen == 15 && !readLength(litLen))
+            return false;
+        if (size_t(iend - ip) < litLen || size_t(oend - op) < litLen)
+            return false;
+        if (litLen >= 16 && size_t(iend - ip) >= litLen + 16 && size_t(oend - op) >= litLen + 16) {
+            // Wild copy: may write up to 15 bytes past the literals, which
+            // the next sequence overwrites
+            for (size_t i = 0; i < litLen; i += 16)
+                std::memcpy(op + i, ip + i, 16);
+        }
+        else {
+            std::memcpy(op, ip, litLen);
+        }
+        ip += litLen;
+        op += litLen;
+        if (ip == iend)
+            break;   // last sequence: literals only
+
+        if (iend - ip < 2)
+            return false;
+        const size_t offset = size_t(ip[0]) | (size_t(ip[1]) << 8);
+        ip += 2;
+        size_t matchLen = token & 15;
+        if (matchLen == 15 && !readLength(matchLen))
+            return false;
+        matchLen += kMinMatch;
+        if (offset == 0 || offset > size_t(op - dst) || size_t(oend - op) < matchLen)
+            return false;
+
+        const unsigned char* match = op - offset;
+        if (offset >= 16 && size_t(oend - op) >= matchLen + 16) {
+            for (size_t i = 0; i < matchLen; i += 16)
+                std::memcpy(op + i, match + i, 16);
+        }
+        else {
+            for (size_t i = 0; i < matchLen; ++i)   // overlapping: byte by byte
+                op[i] = match[i];
+        }
+        op += matchLen;
+    }
+    return op == oend;
+}
+
+} // namespace LzBlock
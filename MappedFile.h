@@ -0,0 +1,158 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Read-only view of a whole file (mmap on POSIX, MapViewOfFile on Windows).
+// The view stays valid until the object is closed or destroyed.
+//
+// The same interface also carries bytes that did not come from a mapping of
+// their own: borrow() wraps memory owned elsewhere (an entry inside a mapped
+// AssetPack, which must outlive the view) and adopt() takes ownership of a
+// heap buffer (a decompressed pack entry).
+class MappedFile {
+public:
+    MappedFile() = default;
+    explicit MappedFile(const std::string& path) { open(path); }
+    ~MappedFile() { close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    MappedFile(MappedFile&& other) noexcept
+        : data_(other.data_), size_(other.size_), mode_(other.mode_) {
+        other.data_ = nullptr;
+        other.size_ = 0;
+        other.mode_ = Mode::Mapped;
+    }
+    MappedFile& operator=(MappedFile&& other) noexcept {
+        if (this != &other) {
+            close();
+            data_ = other.data_;
+            size_ = other.size_;
+            mode_ = other.mode_;
+            other.data_ = nullptr;
+            other.size_ = 0;
+            other.mode_ = Mode::Mapped;
+        }
+        return *this;
+    }
+
+    // View of memory owned by someone else; nothing is freed on close()
+    static MappedFile borrow(const unsigned char* data, size_t size) {
+        MappedFile f;
+        if (data && size) {
+            f.data_ = data;
+            f.size_ = size;
+            f.mode_ = Mode::Borrowed;
+        }
+        return f;
+    }
+
+    // Takes ownership of a heap buffer, freed on close()
+    static MappedFile adopt(std::unique_ptr<unsigned char[]> data, size_t size) {
+        MappedFile f;
+        if (data && size) {
+            f.data_ = data.release();
+            f.size_ = size;
+            f.mode_ = Mode::Owned;
+        }
+        return f;
+    }
+
+    bool open(const std::string& path) {
+        close();
+#ifdef _WIN32
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ,
+            nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+            return false;
+        LARGE_INTEGER len;
+        if (!GetFileSizeEx(file, &len) || len.QuadPart == 0) {
+            CloseHandle(file);
+            return false;
+        }
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        CloseHandle(file);
+        if (!mapping)
+            return false;
+        void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        CloseHandle(mapping);
+        if (!view)
+            return false;
+        data_ = static_cast<const unsigned char*>(view);
+        size_ = static_cast<size_t>(len.QuadPart);
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0) {
+            ::close(fd);
+            return false;
+        }
+        void* view = mmap(nullptr, static_cast<size_t>(st.st_size),
+            PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (view == MAP_FAILED)
+            return false;
+        data_ = static_cast<const unsigned char*>(view);
+        size_ = static_cast<size_t>(st.st_size);
+#endif
+        return true;
+    }
+
+    void close() {
+        if (!data_)
+            return;
+        if (mode_ == Mode::Owned) {
+            delete[] data_;
+        }
+        else if (mode_ == Mode::Mapped) {
+#ifdef _WIN32
+            UnmapViewOfFile(data_);
+#else
+            munmap(const_cast<unsigned char*>(data_), size_);
+#endif
+        }
+        data_ = nullptr;
+        size_ = 0;
+        mode_ = Mode::Mapped;
+    }
+
+    // Hints that the view will be read front to back (madvise on POSIX;
+    // Windows read-ahead needs no hint for mapped views)
+    void adviseSequential() const {
+#ifndef _WIN32
+        if (data_ && mode_ == Mode::Mapped)
+            madvise(const_cast<unsigned char*>(data_), size_, MADV_SEQUENTIAL);
+#endif
+    }
+
+    bool                 valid() const { return data_ != nullptr; }
+    const unsigned char* data()  const { return data_; }
+    size_t               size()  const { return size_; }
+
+private:
+    enum class Mode { Mapped, Borrowed, Owned };
+
+    const unsigned char* data_ = nullptr;
+    size_t               size_ = 0;
+    Mode                 mode_ = Mode::Mapped;
+};
@@ -0,0 +1,317 @@
+#pragma once
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Model.h"
+
+// Efficiency metrics of imported geometry, as it would be drawn:
+//   - duplicate ratio: vertices byte-identical to another one in their mesh
+//     (welding would drop them)
+//   - ACMR / ATVR: vertex shader runs per triangle / per referenced vertex
+//     under a simulated FIFO post-transform cache of kCacheSize entries
+//   - overdraw: fragments that pass a depth test per covered pixel, drawn
+//     in index order at kOverdrawResolution along the three axes, both ways
+// Used by the --analyze mode to find the assets worth optimizing.
+namespace MeshAnalysis {
+
+constexpr uint32_t kCacheSize          = 16;
+constexpr int      kOverdrawResolution = 256;
+
+struct Report {
+    size_t            vertexCount    = 0;
+    size_t            triangleCount  = 0;
+    size_t            duplicates     = 0;
+    size_t            referenced     = 0;   // vertices used by some triangle
+    size_t            cacheMisses    = 0;   // vertex shader runs
+    size_t            bytesPerVertex = 0;
+    size_t            pixelsShaded   = 0;
+    size_t            pixelsCovered  = 0;
+    MeshCache::Bounds bounds;
+
+    double duplicateRatio() const { return vertexCount ? double(duplicates) / vertexCount : 0.0; }
+    double acmr() const { return triangleCount ? double(cacheMisses) / triangleCount : 0.0; }
+    double atvr() const { return referenced ? double(cacheMisses) / referenced : 0.0; }
+    double overdraw() const { return pixelsCovered ? double(pixelsShaded) / pixelsCovered : 0.0; }
+};
+
+// Float geometry of one draw, model space
+struct MeshGeometry {
+    std::vector<Vertex>   vertices;
+    std::vector<uint32_t> indices;
+};
+
+struct ModelReport {
+    std::string         path;
+    ModelStats          stats;
+    const char*         source = "";
+    Report              total;
+    std::vector<Report> meshes;
+};
+
+inline size_t simulateFifoCache(const MeshGeometry& mesh) {
+    // A vertex is cached while fewer than kCacheSize misses happened since
+    // it was inserted
+    std::vector<uint32_t> inserted(mesh.vertices.size(), 0);
+    uint32_t time = kCacheSize + 1;
+    size_t misses = 0;
+    for (uint32_t i : mesh.indices) {
+        if (time - inserted[i] > kCacheSize) {
+            inserted[i] = time++;
+            ++misses;
+        }
+    }
+    return misses;
+}
+
+inline size_t countDuplicates(const MeshGeometry& mesh) {
+    const Vertex* v = mesh.vertices.data();
+    auto hash = [v](uint32_t i) { return size_t(MeshCache::hashBytes(&v[i], sizeof(Vertex))); };
+    auto equal = [v](uint32_t a, uint32_t b) { return std::memcmp(&v[a], &v[b], sizeof(Vertex)) == 0; };
+    std::unordered_set<uint32_t, decltype(hash), decltype(equal)> seen(mesh.vertices.size(), hash, equal);
+    for (uint32_t i = 0; i < mesh.vertices.size(); ++i)
+        seen.insert(i);
+    return mesh.vertices.size() - seen.size();
+}
+
+// Rasterizes `meshes` in order into one depth buffer per view (pixel
+// centers, no culling) and adds the fragments that passed the depth test
+// and the pixels covered to `report`
+inline void measureOverdraw(const std::vector<const MeshGeometry*>& meshes,
+                            const MeshCache::Bounds& bounds, Report& report) {
+    if (bounds.empty())
+        return;
+    const int res = kOverdrawResolution;
+    float extent = 0.0f;
+    for (int k = 0; k < 3; ++k)
+        extent = std::max(extent, bounds.max[k] - bounds.min[k]);
+    const float scale = extent > 0.0f ? (res - 1) / extent : 0.0f;
+    std::vector<float> depth(size_t(res) * res, FLT_MAX);
+    std::vector<size_t> touched;   // reset per view instead of a full clear
+    for (int axis = 0; axis < 3; ++axis) {
+        const int u = (axis + 1) % 3, v = (axis + 2) % 3;
+        for (float dir : { 1.0f, -1.0f }) {
+            for (const MeshGeometry* mesh : meshes) {
+                auto project = [&](uint32_t i) {
+                    const glm::vec3& p = mesh->vertices[i].Position;
+                    return glm::vec3((p[u] - bounds.min[u]) * scale, (p[v] - bounds.min[v]) * scale,
+                                     dir * p[axis]);
+                };
+                for (size_t t = 0; t + 2 < mesh->indices.size(); t += 3) {
+                    const glm::vec3 a = project(mesh->indices[t]);
+                    const glm::vec3 b = project(mesh->indices[t + 1]);
+                    const glm::vec3 c = project(mesh->indices[t + 2]);
+                    const float area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+                    if (area == 0.0f)
+                        continue;
+                    const int x0 = std::max(0, int(std::ceil(std::min({ a.x, b.x, c.x }) - 0.5f)));
+                    const int y0 = std::max(0, int(std::ceil(std::min({ a.y, b.y, c.y }) - 0.5f)));
+                    const int x1 = std::min(res - 1, int(std::floor(std::max({ a.x, b.x, c.x }) - 0.5f)));
+                    const int y1 = std::min(res - 1, int(std::floor(std::max({ a.y, b.y, c.y }) - 0.5f)));
+                    for (int y = y0; y <= y1; ++y) {
+                        for (int x = x0; x <= x1; ++x) {
+                            const float px = x + 0.5f, py = y + 0.5f;
+                            const float w0 = ((c.x - b.x) * (py - b.y) - (c.y - b.y) * (px - b.x)) / area;
+                            const float w1 = ((a.x - c.x) * (py - c.y) - (a.y - c.y) * (px - c.x)) / area;
+                            const float w2 = 1.0f - w0 - w1;
+                            if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f)
+                                continue;
+                            const float z = w0 * a.z + w1 * b.z + w2 * c.z;
+                            float& d = depth[size_t(y) * res + x];
+                            if (z < d) {
+                                if (d == FLT_MAX)
+                                    touched.push_back(size_t(y) * res + x);
+                                d = z;
+                                ++report.pixelsShaded;
+                            }
+                        }
+                    }
+                }
+            }
+            report.pixelsCovered += touched.size();
+            for (size_t i : touched)
+                depth[i] = FLT_MAX;
+            touched.clear();
+        }
+    }
+}
+
+inline Report analyzeMesh(const MeshGeometry& mesh, size_t bytesPerVertex) {
+    Report r;
+    r.vertexCount = mesh.vertices.size();
+    r.triangleCount = mesh.indices.size() / 3;
+    r.bytesPerVertex = bytesPerVertex;
+    r.duplicates = countDuplicates(mesh);
+    r.cacheMisses = simulateFifoCache(mesh);
+    std::vector<bool> used(mesh.vertices.size(), false);
+    for (uint32_t i : mesh.indices)
+        if (!used[i]) {
+            used[i] = true;
+            ++r.referenced;
+        }
+    for (const Vertex& v : mesh.vertices)
+        r.bounds.add(&v.Position.x);
+    measureOverdraw({ &mesh }, r.bounds, r);
+    return r;
+}
+
+// Float copies of what `data` would upload, one per draw. Out-of-range
+// indices are dropped with their triangle.
+inline std::vector<MeshGeometry> extractGeometry(const ModelData& data, size_t& bytesPerVertex) {
+    std::vector<MeshGeometry> out;
+    bytesPerVertex = vertexStride(data.vertexFormat);
+    for (const auto& blob : data.blobs) {
+        MeshGeometry g;
+        g.vertices.resize(blob.vertexCount);
+        if (data.vertexFormat == VertexFormat::Quantized) {
+            const auto* q = static_cast<const CompiledAsset::QuantizedVertex*>(blob.vertices);
+            for (size_t i = 0; i < blob.vertexCount; ++i)
+                CompiledAsset::dequantize(q[i], data.bounds, &g.vertices[i].Position.x, &g.vertices[i].Normal.x);
+        }
+        else {
+            std::memcpy(g.vertices.data(), blob.vertices, blob.vertexCount * sizeof(Vertex));
+        }
+        g.indices.assign(blob.indices, blob.indices + blob.indexCount);
+        out.push_back(std::move(g));
+    }
+    for (const auto& prim : data.gltf.primitives) {
+        MeshGeometry g;
+        g.vertices.resize(prim.vertexCount);
+        const unsigned char* p = data.gltf.views[prim.positionView].data + prim.positionOffset;
+        const unsigned char* n = data.gltf.views[prim.normalView].data + prim.normalOffset;
+        const glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(prim.transform)));
+        for (size_t i = 0; i < prim.vertexCount; ++i, p += prim.positionStride, n += prim.normalStride) {
+            glm::vec3 pos, nrm;
+            std::memcpy(&pos, p, sizeof(pos));
+            std::memcpy(&nrm, n, sizeof(nrm));
+            g.vertices[i].Position = glm::vec3(prim.transform * glm::vec4(pos, 1.0f));
+            g.vertices[i].Normal = normalMatrix * nrm;
+        }
+        const unsigned char* idx = data.gltf.views[prim.indexView].data + prim.indexOffset;
+        g.indices.resize(prim.indexCount);
+        for (size_t i = 0; i < prim.indexCount; ++i) {
+            switch (prim.indexType) {
+            case Gltf::kUnsignedByte:  g.indices[i] = idx[i]; break;
+            case Gltf::kUnsignedShort: { uint16_t s; std::memcpy(&s, idx + 2 * i, 2); g.indices[i] = s; break; }
+            default:                   std::memcpy(&g.indices[i], idx + 4 * i, 4); break;
+            }
+        }
+        bytesPerVertex = size_t(2 * sizeof(glm::vec3));   // drawn from the views as stored
+        out.push_back(std::move(g));
+    }
+    for (auto& g : out) {
+        size_t kept = 0;
+        for (size_t t = 0; t + 2 < g.indices.size(); t += 3) {
+            if (g.indices[t] >= g.vertices.size() || g.indices[t + 1] >= g.vertices.size() ||
+                g.indices[t + 2] >= g.vertices.size())
+                continue;
+            std::memmove(&g.indices[kept], &g.indices[t], 3 * sizeof(uint32_t));
+            kept += 3;
+        }
+        g.indices.resize(kept);
+    }
+    return out;
+}
+
+inline ModelReport analyzeModel(const ModelData& data) {
+    ModelReport report;
+    report.path = data.path;
+    report.stats = data.stats;
+    report.source = data.stats.compiled ? "compiled" : data.stats.fromCache ? "mesh cache"
+                  : !data.gltf.primitives.empty() ? "glTF" : "Assimp";
+    size_t bytesPerVertex = 0;
+    const std::vector<MeshGeometry> meshes = extractGeometry(data, bytesPerVertex);
+    std::vector<const MeshGeometry*> all;
+    Report& t = report.total;
+    t.bytesPerVertex = bytesPerVertex;
+    for (const auto& g : meshes) {
+        report.meshes.push_back(analyzeMesh(g, bytesPerVertex));
+        const Report& m = report.meshes.back();
+        t.vertexCount += m.vertexCount;
+        t.triangleCount += m.triangleCount;
+        t.duplicates += m.duplicates;
+        t.referenced += m.referenced;
+        t.cacheMisses += m.cacheMisses;
+        if (!m.bounds.empty()) {
+            t.bounds.add(m.bounds.min);
+            t.bounds.add(m.bounds.max);
+        }
+        all.push_back(&g);
+    }
+    // Whole-model overdraw: every draw into the same depth buffers
+    measureOverdraw(all, t.bounds, t);
+    return report;
+}
+
+// What would help this model most, most effective first
+inline std::vector<std::string> suggestions(const ModelReport& r) {
+    std::vector<std::string> out;
+    const Report& t = r.total;
+    if (t.duplicateRatio() > 0.05)
+        out.push_back("weld duplicate vertices: render-optimized profile (JoinIdenticalVertices) or assetc");
+    if (t.acmr() > 1.0)
+        out.push_back("reorder triangles for the vertex cache: render-optimized profile "
+                      "(ImproveCacheLocality) or assetc");
+    if (r.meshes.size() > 64)
+        out.push_back("too many draws: merge meshes (render-optimized: OptimizeMeshes/OptimizeGraph) "
+                      "or instance repeated meshes");
+    if (t.triangleCount > 1000000)
+        out.push_back("large static model: split into streaming tiles with assetc --world");
+    if (t.bytesPerVertex > sizeof(CompiledAsset::QuantizedVertex))
+        out.push_back("compile with assetc: " + std::to_string(sizeof(CompiledAsset::QuantizedVertex)) +
+                      "-byte quantized vertices instead of " + std::to_string(t.bytesPerVertex));
+    if (t.overdraw() > 2.5)
+        out.push_back("high overdraw: draw front to back or cull occluded parts");
+    return out;
+}
+
+inline void printReport(std::ostream& out, const ModelReport& r, size_t meshLimit = 10) {
+    auto box = [&](const MeshCache::Bounds& b) {
+        if (b.empty())
+            return std::string("empty");
+        auto v = [](const float* p) {
+            return "(" + std::to_string(p[0]) + ", " + std::to_string(p[1]) + ", " + std::to_string(p[2]) + ")";
+        };
+        return v(b.min) + " - " + v(b.max);
+    };
+    auto line = [&](const Report& m) {
+        out << m.vertexCount << " vertices, " << m.triangleCount << " triangles, "
+            << m.bytesPerVertex << " B/vertex, duplicates " << m.duplicateRatio() * 100.0 << "%, ACMR "
+            << m.acmr() << ", ATVR " << m.atvr() << ", overdraw " << m.overdraw() << "\n";
+    };
+    const Report& t = r.total;
+    out << r.path << " [" << profileName(r.stats.profile) << ", " << r.source << ", "
+        << r.stats.importMs << " ms]\n"
+        << "  " << r.meshes.size() << " draws, ";
+    line(t);
+    out << "  bounds " << box(t.bounds) << "\n";
+
+    std::vector<size_t> order(r.meshes.size());
+    for (size_t i = 0; i < order.size(); ++i)
+        order[i] = i;
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return r.meshes[a].triangleCount > r.meshes[b].triangleCount;
+    });
+    for (size_t k = 0; k < order.size() && k < meshLimit; ++k) {
+        out << "  mesh " << order[k] << ": ";
+        line(r.meshes[order[k]]);
+    }
+    if (order.size() > meshLimit)
+        out << "  ... " << order.size() - meshLimit << " smaller meshes\n";
+    const std::vector<std::string> todo = suggestions(r);
+    for (const auto& s : todo)
+        out << "  -> " << s << "\n";
+    if (todo.empty())
+        out << "  -> no obvious win\n";
+}
+
+} // namespace MeshAnalysis
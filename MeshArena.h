@@ -0,0 +1,429 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "CompiledAsset.h"
+#include "GpuMemory.h"
+
+// Shared storage for static meshes: one arena per vertex format, each a
+// single vertex buffer and index buffer behind one VAO, suballocated
+// first-fit. Meshes placed here draw with glDrawElementsBaseVertex, or all
+// together through glMultiDrawElementsIndirect (see DrawBatch.h).
+//
+// GL 4.3 has no gl_DrawID, so each VAO also carries a per-instance draw
+// index (attribute 2, divisor 1): an indirect command with instanceCount 1
+// and baseInstance = i reads element i.
+//
+// GpuMemory records each arena's capacity. With a limit set (the model
+// budget) an arena never grows past it: allocate() fails instead and the
+// caller keeps the mesh off the GPU. Growing or packing an arena moves its
+// meshes, so a Slot is a handle and range() gives the current placement;
+// once an arena is mostly empty its meshes are packed into smaller buffers.
+//
+// Until init() runs (tools, no context) meshes keep their own buffers.
+// Context thread only.
+namespace MeshArena {
+
+enum class Format { Float, Quantized, Count };
+
+constexpr GLuint kDrawIdAttribute = 2;
+
+// Placement of one mesh, in elements
+struct Range {
+    size_t baseVertex = 0;
+    size_t vertexCount = 0;
+    size_t firstIndex = 0;
+    size_t indexCount = 0;
+};
+
+// A mesh's handle in its arena
+struct Slot {
+    Format   format = Format::Float;
+    uint32_t id = 0;
+    bool     valid = false;
+};
+
+// First-fit ranges with coalescing on release
+class FreeList {
+public:
+    bool allocate(size_t n, size_t& offset) {
+        if (!n) {
+            offset = 0;
+            return true;
+        }
+        for (auto it = ranges.begin(); it != ranges.end(); ++it) {
+            if (it->second < n)
+                continue;
+            offset = it->first;
+            const size_t rest = it->second - n;
+            ranges.erase(it);
+            if (rest)
+                ranges.emplace(offset + n, rest);
+            return true;
+        }
+        return false;
+    }
+
+    void release(size_t offset, size_t n) {
+        if (!n)
+            return;
+        auto next = ranges.lower_bound(offset);
+        if (next != ranges.end() && offset + n == next->first) {
+            n += next->second;
+            next = ranges.erase(next);
+        }
+        if (next != ranges.begin()) {
+            auto prev = std::prev(next);
+            if (prev->first + prev->second == offset) {
+                prev->second += n;
+                return;
+            }
+        }
+        ranges.emplace(offset, n);
+    }
+
+    bool fits(size_t n) const {
+        if (!n)
+            return true;
+        for (const auto& r : ranges)
+            if (r.second >= n)
+                return true;
+        return false;
+    }
+
+    // Everything from `used` to the end is free
+    void reset(size_t used, size_t capacity) {
+        ranges.clear();
+        release(used, capacity - used);
+    }
+
+private:
+    std::map<size_t, size_t> ranges;   // offset -> length
+};
+
+// Total bytes every arena may hold; 0 for no limit
+inline size_t& limit() {
+    static size_t bytes = 0;
+    return bytes;
+}
+
+// Bumped whenever an arena moves its meshes, so placements cached elsewhere
+// (see DrawBatch's resident commands) know to look them up again
+inline uint64_t& generation() {
+    static uint64_t n = 0;
+    return n;
+}
+
+// Packs every arena into buffers just big enough for its meshes
+inline void packAll();
+
+class Arena {
+public:
+    explicit Arena(Format format) : format(format) {
+        glGenVertexArrays(1, &vao);
+    }
+
+    ~Arena() {
+        glDeleteVertexArrays(1, &vao);
+        GpuMemory::deleteBuffer(vbo);
+        GpuMemory::deleteBuffer(ebo);
+    }
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    size_t stride() const {
+        return format == Format::Quantized ? sizeof(CompiledAsset::QuantizedVertex) : 6 * sizeof(float);
+    }
+
+    // False (and `slot` invalid) if the mesh does not fit within limit()
+    bool allocate(size_t vertexCount, size_t indexCount, Slot& slot) {
+        slot.valid = false;
+        if ((!vertices.fits(vertexCount) || !indices.fits(indexCount)) &&
+            !makeRoom(vertexCount, indexCount))
+            return false;
+        Range r;
+        r.vertexCount = vertexCount;
+        r.indexCount = indexCount;
+        vertices.allocate(vertexCount, r.baseVertex);
+        indices.allocate(indexCount, r.firstIndex);
+        vertexUsed += vertexCount;
+        indexUsed += indexCount;
+        uint32_t id = uint32_t(ranges.size());
+        if (!freeIds.empty()) {
+            id = freeIds.back();
+            freeIds.pop_back();
+            ranges[id] = r;
+            live[id] = 1;
+        }
+        else {
+            ranges.push_back(r);
+            live.push_back(1);
+        }
+        slot = { format, id, true };
+        return true;
+    }
+
+    void release(Slot& slot) {
+        if (!slot.valid)
+            return;
+        const Range& r = ranges[slot.id];
+        vertices.release(r.baseVertex, r.vertexCount);
+        indices.release(r.firstIndex, r.indexCount);
+        vertexUsed -= r.vertexCount;
+        indexUsed -= r.indexCount;
+        live[slot.id] = 0;
+        freeIds.push_back(slot.id);
+        slot.valid = false;
+        // Mostly empty: pack what is left into half the space, so the
+        // buffers end up twice the size of what they hold
+        const bool shrinkVertices = vertexCapacity > kMinVertices && vertexUsed < vertexCapacity / 4;
+        const bool shrinkIndices = indexCapacity > kMinIndices && indexUsed < indexCapacity / 4;
+        if (shrinkVertices || shrinkIndices)
+            relocate(shrinkVertices ? std::max(kMinVertices, vertexUsed * 2) : vertexCapacity,
+                     shrinkIndices ? std::max(kMinIndices, indexUsed * 2) : indexCapacity);
+    }
+
+    const Range& range(const Slot& slot) const { return ranges[slot.id]; }
+
+    GLuint vertexArray()  const { return vao; }
+    GLuint vertexBuffer() const { return vbo; }
+    GLuint indexBuffer()  const { return ebo; }
+    size_t capacityBytes() const { return bytesFor(vertexCapacity, indexCapacity); }
+    size_t usedBytes()     const { return bytesFor(vertexUsed, indexUsed); }
+
+    // Moves every mesh to the front of buffers just big enough for them
+    void pack() {
+        if (vertexUsed != vertexCapacity || indexUsed != indexCapacity)
+            relocate(vertexUsed, indexUsed);
+    }
+
+    // Points attribute kDrawIdAttribute at `drawIds` (uint per element)
+    void bindDrawIds(GLuint drawIds) {
+        glBindVertexArray(vao);
+        glBindBuffer(GL_ARRAY_BUFFER, drawIds);
+        glEnableVertexAttribArray(kDrawIdAttribute);
+        glVertexAttribIPointer(kDrawIdAttribute, 1, GL_UNSIGNED_INT, sizeof(GLuint), nullptr);
+        glVertexAttribDivisor(kDrawIdAttribute, 1);
+        glBindVertexArray(0);
+    }
+
+private:
+    static constexpr size_t kMinVertices = size_t(1) << 18;
+    static constexpr size_t kMinIndices  = size_t(1) << 20;
+
+    size_t bytesFor(size_t vertexCount, size_t indexCount) const {
+        return vertexCount * stride() + indexCount * sizeof(uint32_t);
+    }
+
+    // Grows the buffers (doubling) or, when the free space is only
+    // fragmented, packs them, so both counts fit in one range each. Under a
+    // limit the growth shrinks to what is needed, after packing every other
+    // arena; false if even that does not fit.
+    bool makeRoom(size_t vertexCount, size_t indexCount) {
+        const size_t needVertices = vertexUsed + vertexCount;
+        const size_t needIndices = indexUsed + indexCount;
+        size_t v = vertexCapacity, i = indexCapacity;
+        if (needVertices > v)
+            v = std::max(std::max(kMinVertices, v * 2), needVertices);
+        if (needIndices > i)
+            i = std::max(std::max(kMinIndices, i * 2), needIndices);
+        if (limit()) {
+            auto fits = [&](size_t vs, size_t is) {
+                return GpuMemory::assetBytes() - capacityBytes() + bytesFor(vs, is) <= limit();
+            };
+            if (!fits(v, i)) {
+                v = std::max(vertexCapacity, needVertices);
+                i = std::max(indexCapacity, needIndices);
+            }
+            if (!fits(v, i)) {
+                packAll();
+                v = needVertices;
+                i = needIndices;
+            }
+            if (!fits(v, i))
+                return false;
+        }
+        relocate(v, i);
+        return true;
+    }
+
+    // Copies every live mesh, packed in slot order, into new buffers of the
+    // given capacities. Under a limit the data goes through client memory
+    // and the old buffers are freed first, so the two never coexist on the
+    // GPU; otherwise it is copied on the GPU.
+    void relocate(size_t newVertices, size_t newIndices) {
+        const size_t s = stride();
+        const bool viaClient = limit() != 0;
+        std::vector<unsigned char> oldVertices, oldIndices;
+        if (viaClient) {
+            oldVertices.resize(vertexCapacity * s);
+            oldIndices.resize(indexCapacity * sizeof(uint32_t));
+            if (vbo && !oldVertices.empty()) {
+                glBindBuffer(GL_COPY_READ_BUFFER, vbo);
+                glGetBufferSubData(GL_COPY_READ_BUFFER, 0, GLsizeiptr(oldVertices.size()), oldVertices.data());
+            }
+            if (ebo && !oldIndices.empty()) {
+                glBindBuffer(GL_COPY_READ_BUFFER, ebo);
+                glGetBufferSubData(GL_COPY_READ_BUFFER, 0, GLsizeiptr(oldIndices.size()), oldIndices.data());
+            }
+            GpuMemory::deleteBuffer(vbo);
+            GpuMemory::deleteBuffer(ebo);
+        }
+
+        GLuint newVbo = 0, newEbo = 0;
+        glGenBuffers(1, &newVbo);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, newVbo);
+        glBufferData(GL_COPY_WRITE_BUFFER, GLsizeiptr(newVertices * s), nullptr, GL_STATIC_DRAW);
+        glGenBuffers(1, &newEbo);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, newEbo);
+        glBufferData(GL_COPY_WRITE_BUFFER, GLsizeiptr(newIndices * sizeof(uint32_t)), nullptr, GL_STATIC_DRAW);
+
+        // Moves `n` bytes at `from` in the old buffer to `to` in `dst`
+        auto move = [&](GLuint src, const std::vector<unsigned char>& client, GLuint dst,
+                        size_t from, size_t to, size_t n) {
+            if (!n)
+                return;
+            glBindBuffer(GL_COPY_WRITE_BUFFER, dst);
+            if (viaClient) {
+                glBufferSubData(GL_COPY_WRITE_BUFFER, GLintptr(to), GLsizeiptr(n), client.data() + from);
+                return;
+            }
+            glBindBuffer(GL_COPY_READ_BUFFER, src);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, GLintptr(from), GLintptr(to), GLsizeiptr(n));
+        };
+        size_t v = 0, i = 0;
+        for (size_t id = 0; id < ranges.size(); ++id) {
+            if (!live[id])
+                continue;
+            Range& r = ranges[id];
+            move(vbo, oldVertices, newVbo, r.baseVertex * s, v * s, r.vertexCount * s);
+            move(ebo, oldIndices, newEbo, r.firstIndex * sizeof(uint32_t), i * sizeof(uint32_t),
+                r.indexCount * sizeof(uint32_t));
+            r.baseVertex = v;
+            r.firstIndex = i;
+            v += r.vertexCount;
+            i += r.indexCount;
+        }
+        if (!viaClient) {
+            GpuMemory::deleteBuffer(vbo);
+            GpuMemory::deleteBuffer(ebo);
+        }
+        vbo = newVbo;
+        ebo = newEbo;
+        vertexCapacity = newVertices;
+        indexCapacity = newIndices;
+        vertices.reset(v, vertexCapacity);
+        indices.reset(i, indexCapacity);
+        ++generation();
+        GpuMemory::track(GpuMemory::Kind::Buffer, vbo, vertexCapacity * s);
+        GpuMemory::track(GpuMemory::Kind::Buffer, ebo, indexCapacity * sizeof(uint32_t));
+
+        glBindVertexArray(vao);
+        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        const GLsizei gs = GLsizei(s);
+        glEnableVertexAttribArray(0);
+        glEnableVertexAttribArray(1);
+        if (format == Format::Quantized) {
+            glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, gs,
+                reinterpret_cast<void*>(offsetof(CompiledAsset::QuantizedVertex, position)));
+            glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, gs,
+                reinterpret_cast<void*>(offsetof(CompiledAsset::QuantizedVertex, normal)));
+        }
+        else {
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, gs, nullptr);
+            glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, gs, reinterpret_cast<void*>(3 * sizeof(float)));
+        }
+        // The element binding is VAO state
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    Format   format;
+    GLuint   vao = 0, vbo = 0, ebo = 0;
+    size_t   vertexCapacity = 0, indexCapacity = 0;
+    size_t   vertexUsed = 0, indexUsed = 0;
+    FreeList vertices, indices;
+    std::vector<Range>    ranges;   // indexed by Slot::id
+    std::vector<uint8_t>  live;
+    std::vector<uint32_t> freeIds;
+};
+
+struct State {
+    std::unique_ptr<Arena> arenas[size_t(Format::Count)];
+    GLuint                 drawIds = 0;
+    size_t                 drawIdCapacity = 0;
+};
+
+inline State& state() {
+    static State s;
+    return s;
+}
+
+inline bool enabled() { return state().arenas[0] != nullptr; }
+
+// Context thread, after GL is loaded
+inline void init() {
+    State& s = state();
+    for (size_t f = 0; f < size_t(Format::Count); ++f)
+        s.arenas[f] = std::make_unique<Arena>(Format(f));
+}
+
+// Context thread, after every mesh is gone
+inline void shutdown() {
+    State& s = state();
+    for (auto& a : s.arenas)
+        a.reset();
+    GpuMemory::deleteBuffer(s.drawIds);
+    s.drawIdCapacity = 0;
+}
+
+inline Arena& arena(Format format) { return *state().arenas[size_t(format)]; }
+
+inline const Range& range(const Slot& slot) { return arena(slot.format).range(slot); }
+
+inline void packAll() {
+    for (auto& a : state().arenas)
+        a->pack();
+}
+
+// Arena space no mesh is using
+inline size_t unusedBytes() {
+    size_t bytes = 0;
+    if (enabled())
+        for (auto& a : state().arenas)
+            bytes += a->capacityBytes() - a->usedBytes();
+    return bytes;
+}
+
+// Makes draw indices [0, count) available to every arena's VAO
+inline void reserveDrawIds(size_t count) {
+    State& s = state();
+    if (count <= s.drawIdCapacity)
+        return;
+    size_t capacity = std::max<size_t>(1024, s.drawIdCapacity);
+    while (capacity < count)
+        capacity *= 2;
+    std::vector<GLuint> ids(capacity);
+    for (size_t i = 0; i < capacity; ++i)
+        ids[i] = GLuint(i);
+    GpuMemory::deleteBuffer(s.drawIds, GpuMemory::Kind::Staging);
+    glGenBuffers(1, &s.drawIds);
+    glBindBuffer(GL_ARRAY_BUFFER, s.drawIds);
+    glBufferData(GL_ARRAY_BUFFER, GLsizeiptr(capacity * sizeof(GLuint)), ids.data(), GL_STATIC_DRAW);
+    GpuMemory::track(GpuMemory::Kind::Staging, s.drawIds, capacity * sizeof(GLuint));
+    s.drawIdCapacity = capacity;
+    for (auto& a : s.arenas)
+        a->bindDrawIds(s.drawIds);
+}
+
+} // namespace MeshArena
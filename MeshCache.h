@@ -0,0 +1,257 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "MappedFile.h"
+
+// On-disk cache of imported models: ready-to-upload vertex and index blobs.
+//
+// File layout (all offsets from the start of the file, blobs 16-byte aligned):
+//   FileHeader | source path | MeshRecord[meshCount] | vertex/index blobs
+//
+// A cache file is keyed by the canonical source path and the import flags,
+// and is only used while the source size and modification time still match.
+// The header also carries the model's bounding box so a loader can show a
+// proxy before the geometry itself is read (peekBounds()).
+namespace MeshCache {
+
+constexpr uint32_t kMagic   = 0x43574D4D; // "MMWC"
+constexpr uint32_t kVersion = 3;
+const char* const  kCacheDir = "cache";
+
+struct FileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t importFlags;
+    uint32_t vertexStride;
+    uint64_t sourceSize;
+    int64_t  sourceTime;
+    uint32_t meshCount;
+    uint32_t pathLength;
+    float    boundsMin[3];
+    float    boundsMax[3];
+};
+
+struct MeshRecord {
+    uint64_t vertexOffset;
+    uint64_t vertexCount;
+    uint64_t indexOffset;
+    uint64_t indexCount;
+};
+
+// True if both of the record's blobs lie inside a file of `size` bytes.
+// The fields come from the file, so each is checked on its own rather than
+// summed, which could wrap.
+inline bool recordFits(const MeshRecord& rec, size_t vertexStride, size_t size) {
+    return rec.vertexOffset <= size && rec.vertexCount <= (size - rec.vertexOffset) / vertexStride &&
+           rec.indexOffset <= size && rec.indexCount <= (size - rec.indexOffset) / sizeof(uint32_t);
+}
+
+// One mesh worth of geometry, either inside a mapping or in caller memory
+struct MeshBlob {
+    const void*     vertices;
+    size_t          vertexCount;
+    const uint32_t* indices;
+    size_t          indexCount;
+};
+
+inline uint64_t hashBytes(const void* data, size_t len, uint64_t h = 1469598103934665603ull) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < len; ++i) {
+        h ^= p[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+inline std::string canonicalPath(const std::string& path) {
+    std::error_code ec;
+    std::filesystem::path p = std::filesystem::weakly_canonical(path, ec);
+    return ec ? path : p.generic_string();
+}
+
+inline std::string cachePathFor(const std::string& source, unsigned importFlags) {
+    std::string key = canonicalPath(source);
+    uint64_t h = hashBytes(key.data(), key.size());
+    h = hashBytes(&importFlags, sizeof(importFlags), h);
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.mesh", static_cast<unsigned long long>(h));
+    return (std::filesystem::path(kCacheDir) / name).string();
+}
+
+inline bool sourceStamp(const std::string& source, uint64_t& size, int64_t& time) {
+    std::error_code ec;
+    size = std::filesystem::file_size(source, ec);
+    if (ec)
+        return false;
+    auto t = std::filesystem::last_write_time(source, ec);
+    if (ec)
+        return false;
+    time = static_cast<int64_t>(t.time_since_epoch().count());
+    return true;
+}
+
+inline size_t align16(size_t v) { return (v + 15) & ~size_t(15); }
+
+// Axis-aligned box in model space; empty while min > max
+struct Bounds {
+    float min[3] = {  1e30f,  1e30f,  1e30f };
+    float max[3] = { -1e30f, -1e30f, -1e30f };
+
+    bool empty() const { return min[0] > max[0]; }
+    void add(const float* p) {
+        for (int k = 0; k < 3; ++k) {
+            if (p[k] < min[k]) min[k] = p[k];
+            if (p[k] > max[k]) max[k] = p[k];
+        }
+    }
+};
+
+// Positions are the first three floats of every vertex
+inline Bounds computeBounds(const std::vector<MeshBlob>& meshes, uint32_t vertexStride) {
+    Bounds b;
+    for (const MeshBlob& m : meshes) {
+        const unsigned char* v = static_cast<const unsigned char*>(m.vertices);
+        for (size_t i = 0; i < m.vertexCount; ++i, v += vertexStride) {
+            float p[3];
+            std::memcpy(p, v, sizeof(p));
+            b.add(p);
+        }
+    }
+    return b;
+}
+
+// Reads and validates the header of the cache entry for `source`
+inline bool readHeader(const std::string& source, unsigned importFlags, uint32_t vertexStride,
+                       const unsigned char* data, size_t size, FileHeader& hdr) {
+    uint64_t srcSize;
+    int64_t  srcTime;
+    if (size < sizeof(FileHeader) || !sourceStamp(source, srcSize, srcTime))
+        return false;
+    std::memcpy(&hdr, data, sizeof(hdr));
+    return hdr.magic == kMagic && hdr.version == kVersion &&
+        hdr.importFlags == importFlags && hdr.vertexStride == vertexStride &&
+        hdr.sourceSize == srcSize && hdr.sourceTime == srcTime;
+}
+
+// Bounding box from a valid cache entry, without mapping the geometry.
+// Cheap enough to call on the render thread before queueing a load.
+inline bool peekBounds(const std::string& source, unsigned importFlags, uint32_t vertexStride,
+                       Bounds& out) {
+    std::ifstream in(cachePathFor(source, importFlags), std::ios::binary);
+    unsigned char buf[sizeof(FileHeader)];
+    if (!in.read(reinterpret_cast<char*>(buf), sizeof(buf)))
+        return false;
+    FileHeader hdr;
+    if (!readHeader(source, importFlags, vertexStride, buf, sizeof(buf), hdr))
+        return false;
+    std::memcpy(out.min, hdr.boundsMin, sizeof(out.min));
+    std::memcpy(out.max, hdr.boundsMax, sizeof(out.max));
+    return !out.empty();
+}
+
+// Maps the cache entry for `source` and fills `meshes` with views into it
+// and `bounds` with the stored box.
+// Returns false on a miss (no entry, stale entry or a different layout).
+inline bool load(const std::string& source, unsigned importFlags, uint32_t vertexStride,
+                 MappedFile& file, std::vector<MeshBlob>& meshes, Bounds& bounds) {
+    if (!file.open(cachePathFor(source, importFlags)))
+        return false;
+
+    const unsigned char* base = file.data();
+    FileHeader hdr;
+    std::string key = canonicalPath(source);
+    if (!readHeader(source, importFlags, vertexStride, base, file.size(), hdr) ||
+        hdr.pathLength != key.size())
+        return false;
+    std::memcpy(bounds.min, hdr.boundsMin, sizeof(bounds.min));
+    std::memcpy(bounds.max, hdr.boundsMax, sizeof(bounds.max));
+
+    size_t pathOffset = sizeof(FileHeader);
+    size_t tableOffset = align16(pathOffset + hdr.pathLength);
+    if (tableOffset + size_t(hdr.meshCount) * sizeof(MeshRecord) > file.size() ||
+        std::memcmp(base + pathOffset, key.data(), key.size()) != 0)
+        return false;
+
+    meshes.clear();
+    meshes.reserve(hdr.meshCount);
+    for (uint32_t i = 0; i < hdr.meshCount; ++i) {
+        MeshRecord rec;
+        std::memcpy(&rec, base + tableOffset + i * sizeof(MeshRecord), sizeof(rec));
+        if (!recordFits(rec, vertexStride, file.size()))
+            return false;
+        meshes.push_back({ base + rec.vertexOffset, size_t(rec.vertexCount),
+            reinterpret_cast<const uint32_t*>(base + rec.indexOffset), size_t(rec.indexCount) });
+    }
+    return true;
+}
+
+// Writes a cache entry for `source`. The file is written under a temporary
+// name and renamed so a crashed write never leaves a half-valid entry.
+inline bool store(const std::string& source, unsigned importFlags, uint32_t vertexStride,
+                  const std::vector<MeshBlob>& meshes, const Bounds& bounds) {
+    FileHeader hdr{};
+    hdr.magic = kMagic;
+    hdr.version = kVersion;
+    hdr.importFlags = importFlags;
+    hdr.vertexStride = vertexStride;
+    hdr.meshCount = static_cast<uint32_t>(meshes.size());
+    std::memcpy(hdr.boundsMin, bounds.min, sizeof(hdr.boundsMin));
+    std::memcpy(hdr.boundsMax, bounds.max, sizeof(hdr.boundsMax));
+    if (!sourceStamp(source, hdr.sourceSize, hdr.sourceTime))
+        return false;
+    std::string key = canonicalPath(source);
+    hdr.pathLength = static_cast<uint32_t>(key.size());
+
+    std::vector<MeshRecord> table(meshes.size());
+    size_t offset = align16(align16(sizeof(FileHeader) + key.size()) +
+        meshes.size() * sizeof(MeshRecord));
+    for (size_t i = 0; i < meshes.size(); ++i) {
+        table[i].vertexOffset = offset;
+        table[i].vertexCount = meshes[i].vertexCount;
+        offset = align16(offset + meshes[i].vertexCount * vertexStride);
+        table[i].indexOffset = offset;
+        table[i].indexCount = meshes[i].indexCount;
+        offset = align16(offset + meshes[i].indexCount * sizeof(uint32_t));
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(kCacheDir, ec);
+    std::string finalPath = cachePathFor(source, importFlags);
+    std::string tmpPath = finalPath + ".tmp";
+    {
+        std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!out)
+            return false;
+        const char zeros[16] = {};
+        auto pad = [&]() {
+            size_t at = static_cast<size_t>(out.tellp());
+            out.write(zeros, align16(at) - at);
+        };
+        out.write(reinterpret_cast<const char*>(&hdr), sizeof(hdr));
+        out.write(key.data(), key.size());
+        pad();
+        out.write(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(MeshRecord));
+        pad();
+        for (const MeshBlob& m : meshes) {
+            out.write(static_cast<const char*>(m.vertices), m.vertexCount * vertexStride);
+            pad();
+            out.write(reinterpret_cast<const char*>(m.indices), m.indexCount * sizeof(uint32_t));
+            pad();
+        }
+        if (!out)
+            return false;
+    }
+    std::filesystem::remove(finalPath, ec);
+    std::filesystem::rename(tmpPath, finalPath, ec);
+    return !ec;
+}
+
+} // namespace MeshCache
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+#include <assimp/DefaultIOSystem.h>
+#include <assimp/IOStream.hpp>
+#include <assimp/IOSystem.hpp>
+
+#include "AssetPack.h"
+#include "MappedFile.h"
+
+// Assimp stream over a read-only file mapping: Read() copies straight out of
+// the page cache instead of going through a stdio buffer first.
+class MappedIOStream : public Assimp::IOStream {
+public:
+    explicit MappedIOStream(MappedFile&& file) : file(std::move(file)) {}
+
+    size_t Read(void* buffer, size_t size, size_t count) override {
+        if (size == 0 || count == 0)
+            return 0;
+        const size_t available = (file.size() - pos) / size;
+        count = std::min(count, available);
+        std::memcpy(buffer, file.data() + pos, size * count);
+        pos += size * count;
+        return count;
+    }
+
+    size_t Write(const void*, size_t, size_t) override { return 0; }
+
+    aiReturn Seek(size_t offset, aiOrigin origin) override {
+        size_t target;
+        switch (origin) {
+        case aiOrigin_SET: target = offset; break;
+        case aiOrigin_CUR: target = pos + offset; break;
+        case aiOrigin_END: target = file.size() - offset; break;
+        default: return aiReturn_FAILURE;
+        }
+        if (target > file.size())
+            return aiReturn_FAILURE;
+        pos = target;
+        return aiReturn_SUCCESS;
+    }
+
+    size_t Tell()     const override { return pos; }
+    size_t FileSize() const override { return file.size(); }
+    void   Flush() override {}
+
+private:
+    MappedFile file;
+    size_t     pos = 0;
+};
+
+// IOSystem that serves every readable file as a mapped view, from a mounted
+// AssetPack when one has it. Write modes and files that cannot be mapped
+// (e.g. empty ones) go to Assimp's default implementation.
+class MmapIOSystem : public Assimp::IOSystem {
+public:
+    bool Exists(const char* path) const override {
+        return AssetFiles::exists(path);
+    }
+
+    char getOsSeparator() const override {
+#ifdef _WIN32
+        return '\\';
+#else
+        return '/';
+#endif
+    }
+
+    Assimp::IOStream* Open(const char* path, const char* mode = "rb") override {
+        if (std::strchr(mode, 'w') || std::strchr(mode, 'a') || std::strchr(mode, '+'))
+            return fallback.Open(path, mode);
+        MappedFile file;
+        if (!AssetFiles::open(path, file))
+            return fallback.Open(path, mode);
+        file.adviseSequential();
+        return new MappedIOStream(std::move(file));
+    }
+
+    void Close(Assimp::IOStream* stream) override { delete stream; }
+
+private:
+    Assimp::DefaultIOSystem fallback;
+};
@@ -0,0 +1,1032 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+
+#include "CompiledAsset.h"
+#include "GltfLoader.h"
+#include "ImportProfile.h"
+#include "MeshArena.h"
+#include "MeshCache.h"
+#include "MmapIOSystem.h"
+#include "NodeAnimation.h"
+#include "UploadRing.h"
+#include "VertexConvert.h"
+
+// Vertex structure
+struct Vertex {
+    glm::vec3 Position;
+    glm::vec3 Normal;
+};
+
+// Layout of vertex blobs: Vertex, or CompiledAsset::QuantizedVertex for
+// meshes built by assetc
+enum class VertexFormat { Float, Quantized };
+
+inline size_t vertexStride(VertexFormat format) {
+    return format == VertexFormat::Quantized ? sizeof(CompiledAsset::QuantizedVertex) : sizeof(Vertex);
+}
+
+// Geometry of one mesh as produced by the CPU import phase
+struct MeshData {
+    std::vector<Vertex>       vertices;
+    std::vector<unsigned int> indices;
+    int                       node = -1;   // NodeData it moves with; -1: model space
+};
+
+// Load statistics, reported per model and aggregated per import profile
+struct ModelStats {
+    ImportProfile profile     = ImportProfile::RenderOptimized;
+    bool          fromCache   = false;
+    bool          compiled    = false;   // read from assetc output
+    double        importMs    = 0.0;   // CPU phase (cache map or Assimp import)
+    double        uploadMs    = 0.0;   // GL phase
+    size_t        vertexCount = 0;
+    size_t        indexCount  = 0;
+    size_t        drawCount   = 0;     // glDrawElements calls per Model::Draw
+};
+
+// Result of the CPU phase of loading a model. Holds either freshly imported
+// geometry or a mapping of its cache (or compiled) file; `blobs` points into
+// whichever one is in use, in `vertexFormat`. glTF fast-path loads fill `gltf` instead. `staged` holds the
+// staging-ring copies made by stageModel(), one per blob (or per glTF view).
+struct ModelData {
+    std::string                      path;
+    std::vector<MeshData>            meshes;
+    std::vector<NodeData>            nodes;
+    std::vector<AnimationClip>       clips;
+    MappedFile                       cacheFile;
+    std::vector<MeshCache::MeshBlob> blobs;
+    VertexFormat                     vertexFormat = VertexFormat::Float;
+    Gltf::Asset                      gltf;
+    std::vector<StagingRegion>       staged;
+    MeshCache::Bounds                bounds;
+    // Per blob (or glTF primitive), in the space of its own vertices
+    std::vector<MeshCache::Bounds>   meshBounds;
+    // Occluder for software occlusion culling, see computeOccluder()
+    std::vector<glm::vec3>           occluder;
+    ModelStats                       stats;
+    bool                             ok = false;
+};
+
+static_assert(sizeof(Vertex) == 6 * sizeof(float), "Vertex must stay packed Position/Normal");
+static_assert(sizeof(unsigned int) == sizeof(uint32_t), "indices are uploaded as uint32");
+
+inline MeshData processMesh(const aiMesh* mesh) {
+    MeshData out;
+    const size_t numVerts = mesh->mNumVertices;
+    const size_t numFaces = mesh->mNumFaces;
+
+    // Vertices: one bulk interleave instead of per-field copies
+    out.vertices.resize(numVerts);
+    VertexConvert::interleave(mesh->mVertices,
+        mesh->HasNormals() ? mesh->mNormals : nullptr,
+        numVerts, reinterpret_cast<float*>(out.vertices.data()));
+
+    // Faces (indices): after aiProcess_Triangulate these are index triples;
+    // points/lines left in the mesh take the generic path
+    out.indices.resize(numFaces * 3);
+    size_t copied = VertexConvert::copyTriangles(mesh->mFaces, numFaces, out.indices.data());
+    if (copied < numFaces) {
+        out.indices.resize(copied * 3);
+        for (size_t i = copied; i < numFaces; ++i) {
+            const aiFace& face = mesh->mFaces[i];
+            out.indices.insert(out.indices.end(), face.mIndices, face.mIndices + face.mNumIndices);
+        }
+    }
+    return out;
+}
+
+inline glm::mat4 toGlm(const aiMatrix4x4& m) {
+    // aiMatrix4x4 is row-major
+    return glm::transpose(glm::make_mat4(&m.a1));
+}
+
+// Moves `part` into `target`, transforming its vertices by `m` on the way
+inline void appendBaked(MeshData& target, MeshData&& part, const glm::mat4& m) {
+    if (m != glm::mat4(1.0f)) {
+        const glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(m)));
+        for (Vertex& v : part.vertices) {
+            v.Position = glm::vec3(m * glm::vec4(v.Position, 1.0f));
+            const glm::vec3 n = normalMatrix * v.Normal;
+            const float len = glm::length(n);
+            v.Normal = len > 0.0f ? n / len : n;
+        }
+        // A mirroring transform flips the winding; flip it back
+        if (glm::determinant(glm::mat3(m)) < 0.0f)
+            for (size_t i = 0; i + 2 < part.indices.size(); i += 3)
+                std::swap(part.indices[i + 1], part.indices[i + 2]);
+    }
+    if (target.vertices.empty()) {
+        target.vertices = std::move(part.vertices);
+        target.indices = std::move(part.indices);
+        return;
+    }
+    const unsigned int base = static_cast<unsigned int>(target.vertices.size());
+    target.vertices.insert(target.vertices.end(), part.vertices.begin(), part.vertices.end());
+    target.indices.reserve(target.indices.size() + part.indices.size());
+    for (unsigned int i : part.indices)
+        target.indices.push_back(base + i);
+}
+
+struct NodeWalk {
+    const aiScene*                           scene;
+    std::vector<MeshData>&                   meshes;
+    std::vector<NodeData>*                   nodes;
+    std::unordered_set<std::string>          animated;
+    std::map<std::pair<int, unsigned>, size_t> merged;   // (node, material) -> mesh
+
+    void visit(const aiNode* node, const glm::mat4& parentToGroup, int group) {
+        glm::mat4 toGroup = parentToGroup * toGlm(node->mTransformation);
+        if (nodes && animated.count(node->mName.C_Str())) {
+            nodes->push_back({ node->mName.C_Str(), group, parentToGroup, toGlm(node->mTransformation) });
+            group = static_cast<int>(nodes->size()) - 1;
+            toGroup = glm::mat4(1.0f);
+        }
+        for (unsigned int i = 0; i < node->mNumMeshes; ++i) {
+            const aiMesh* ai_mesh = scene->mMeshes[node->mMeshes[i]];
+            auto slot = merged.emplace(std::make_pair(group, ai_mesh->mMaterialIndex), meshes.size());
+            if (slot.second) {
+                meshes.emplace_back();
+                meshes.back().node = group;
+            }
+            appendBaked(meshes[slot.first->second], processMesh(ai_mesh), toGroup);
+        }
+        for (unsigned int i = 0; i < node->mNumChildren; ++i)
+            visit(node->mChildren[i], toGroup, group);
+    }
+};
+
+// Flattens the node tree: every node transform is baked into the vertices
+// and meshes sharing a material become one draw. With `nodes`, nodes that
+// an animation channel targets stay separate (with their subtree's meshes
+// in their space), so they can still move; without it everything is baked
+// in the bind pose.
+inline void processNode(const aiNode* node, const aiScene* scene, std::vector<MeshData>& meshes,
+                        std::vector<NodeData>* nodes = nullptr) {
+    NodeWalk walk{ scene, meshes, nodes, {}, {} };
+    if (nodes)
+        for (unsigned int a = 0; a < scene->mNumAnimations; ++a)
+            for (unsigned int c = 0; c < scene->mAnimations[a]->mNumChannels; ++c)
+                walk.animated.insert(scene->mAnimations[a]->mChannels[c]->mNodeName.C_Str());
+    walk.visit(node, glm::mat4(1.0f), -1);
+}
+
+// Model-space box of a glTF asset: every primitive's positions through its
+// node transform
+inline MeshCache::Bounds gltfBounds(const Gltf::Asset& asset) {
+    MeshCache::Bounds b;
+    for (const auto& prim : asset.primitives) {
+        const unsigned char* p = asset.views[prim.positionView].data + prim.positionOffset;
+        for (size_t i = 0; i < prim.vertexCount; ++i, p += prim.positionStride) {
+            glm::vec3 v;
+            std::memcpy(&v, p, sizeof(v));
+            v = glm::vec3(prim.transform * glm::vec4(v, 1.0f));
+            b.add(&v.x);
+        }
+    }
+    return b;
+}
+
+// Boxes for culling, one per mesh, before the mesh's transform: float
+// blobs in model (or node) space, quantized blobs in [0,1]^3, glTF
+// primitives in their node's space
+inline void computeMeshBounds(ModelData& data) {
+    data.meshBounds.clear();
+    const size_t stride = vertexStride(data.vertexFormat);
+    for (const MeshCache::MeshBlob& blob : data.blobs) {
+        MeshCache::Bounds b;
+        const unsigned char* v = static_cast<const unsigned char*>(blob.vertices);
+        for (size_t i = 0; i < blob.vertexCount; ++i, v += stride) {
+            float p[3];
+            if (data.vertexFormat == VertexFormat::Quantized) {
+                const auto* q = reinterpret_cast<const CompiledAsset::QuantizedVertex*>(v);
+                for (int k = 0; k < 3; ++k)
+                    p[k] = q->position[k] / 65535.0f;
+            }
+            else {
+                std::memcpy(p, v, sizeof(p));
+            }
+            b.add(p);
+        }
+        data.meshBounds.push_back(b);
+    }
+    for (const auto& prim : data.gltf.primitives) {
+        MeshCache::Bounds b;
+        const unsigned char* p = data.gltf.views[prim.positionView].data + prim.positionOffset;
+        for (size_t i = 0; i < prim.vertexCount; ++i, p += prim.positionStride) {
+            float v[3];
+            std::memcpy(v, p, sizeof(v));
+            b.add(v);
+        }
+        data.meshBounds.push_back(b);
+    }
+}
+
+constexpr size_t kOccluderTriangles = 2048;
+
+// Simplified stand-in for occlusion culling: the model's largest triangles
+// (walls and roofs rather than window frames), three model-space points
+// each, at most kOccluderTriangles. Being real surfaces they never hide
+// anything the full mesh would not. Meshes on animated nodes move, and
+// glTF models are small props, so neither contributes.
+inline void computeOccluder(ModelData& data) {
+    data.occluder.clear();
+    if (data.bounds.empty())
+        return;
+    const glm::vec3 lo = glm::make_vec3(data.bounds.min);
+    const glm::vec3 extent = glm::make_vec3(data.bounds.max) - lo;
+    // Triangles below this area cover too little to be worth rasterizing
+    const float minArea = glm::dot(extent, extent) / (128.0f * 128.0f);
+    const size_t stride = vertexStride(data.vertexFormat);
+    auto position = [&](const MeshCache::MeshBlob& blob, uint32_t i) {
+        const unsigned char* v = static_cast<const unsigned char*>(blob.vertices) + size_t(i) * stride;
+        if (data.vertexFormat == VertexFormat::Quantized) {
+            const auto* q = reinterpret_cast<const CompiledAsset::QuantizedVertex*>(v);
+            return lo + glm::vec3(q->position[0], q->position[1], q->position[2]) / 65535.0f * extent;
+        }
+        glm::vec3 p;
+        std::memcpy(&p, v, sizeof(p));
+        return p;
+    };
+
+    struct Candidate {
+        float    area;
+        uint32_t blob, first;
+    };
+    std::vector<Candidate> candidates;
+    for (size_t b = 0; b < data.blobs.size(); ++b) {
+        if (b < data.meshes.size() && data.meshes[b].node >= 0)
+            continue;
+        const MeshCache::MeshBlob& blob = data.blobs[b];
+        for (size_t i = 0; i + 2 < blob.indexCount; i += 3) {
+            const glm::vec3 a = position(blob, blob.indices[i]);
+            const float area = 0.5f * glm::length(glm::cross(position(blob, blob.indices[i + 1]) - a,
+                                                             position(blob, blob.indices[i + 2]) - a));
+            if (area >= minArea)
+                candidates.push_back({ area, uint32_t(b), uint32_t(i) });
+        }
+    }
+    if (candidates.size() > kOccluderTriangles) {
+        std::nth_element(candidates.begin(), candidates.begin() + kOccluderTriangles, candidates.end(),
+            [](const Candidate& x, const Candidate& y) { return x.area > y.area; });
+        candidates.resize(kOccluderTriangles);
+    }
+    data.occluder.reserve(candidates.size() * 3);
+    for (const Candidate& c : candidates)
+        for (uint32_t k = 0; k < 3; ++k)
+            data.occluder.push_back(position(data.blobs[c.blob], data.blobs[c.blob].indices[c.first + k]));
+}
+
+inline void finishStats(ModelData& data, std::chrono::steady_clock::time_point start) {
+    data.stats.importMs = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+    data.stats.drawCount = data.blobs.size() + data.gltf.primitives.size();
+    for (const auto& b : data.blobs) {
+        data.stats.vertexCount += b.vertexCount;
+        data.stats.indexCount += b.indexCount;
+    }
+    for (const auto& p : data.gltf.primitives) {
+        data.stats.vertexCount += p.vertexCount;
+        data.stats.indexCount += p.indexCount;
+    }
+}
+
+// CPU phase: compiled asset, glTF fast path, cache lookup, or Assimp
+// import plus cache write. Touches no GL state, so it may run on any thread as long as each
+// thread has its own importer.
+inline ModelData importModel(const std::string& path, Assimp::Importer& importer,
+                             ImportProfile profile = ImportProfile::RenderOptimized) {
+    const auto start = std::chrono::steady_clock::now();
+    const unsigned int importFlags = importFlagsFor(profile);
+    ModelData data;
+    data.path = path;
+    data.stats.profile = profile;
+
+    // Shipped builds: map the assetc output, no import work at all. Physics
+    // needs float CPU geometry, so it keeps using the import paths below.
+    if (!profileKeepsCpuGeometry(profile) &&
+        CompiledAsset::loadMesh(path, profileName(profile), data.cacheFile, data.blobs, data.bounds)) {
+        data.vertexFormat = VertexFormat::Quantized;
+        data.stats.compiled = true;
+        computeMeshBounds(data);
+        computeOccluder(data);
+        finishStats(data, start);
+        data.ok = true;
+        return data;
+    }
+    data.cacheFile.close();
+    data.blobs.clear();
+
+    // glTF: map the .bin and draw straight out of its bufferViews. Physics
+    // needs Vertex-format CPU geometry, so it always goes through Assimp.
+    if (!profileKeepsCpuGeometry(profile) && Gltf::isGltfPath(path)) {
+        if (Gltf::load(path, data.gltf)) {
+            data.bounds = gltfBounds(data.gltf);
+            computeMeshBounds(data);
+            computeOccluder(data);
+            finishStats(data, start);
+            data.ok = true;
+            return data;
+        }
+        data.gltf = Gltf::Asset();
+    }
+
+    // Warm start: the blobs point straight into the mapped cache file
+    if (MeshCache::load(path, importFlags, sizeof(Vertex), data.cacheFile, data.blobs, data.bounds)) {
+        data.stats.fromCache = true;
+        computeMeshBounds(data);
+        computeOccluder(data);
+        finishStats(data, start);
+        data.ok = true;
+        return data;
+    }
+    data.cacheFile.close();
+
+    // Cold start: import with Assimp and write the cache for next time.
+    // Source files are read through mapped views rather than stdio buffers.
+    if (!dynamic_cast<MmapIOSystem*>(importer.GetIOHandler()))
+        importer.SetIOHandler(new MmapIOSystem);
+    configureImporter(importer, profile);
+    const aiScene* scene = importer.ReadFile(path, importFlags);
+    if (!scene ||
+        scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE ||
+        !scene->mRootNode) {
+        std::cerr << "ERROR::ASSIMP::"
+            << importer.GetErrorString()
+            << std::endl;
+        return data;
+    }
+    // Physics wants plain model-space geometry, so it bakes animated nodes too
+    processNode(scene->mRootNode, scene, data.meshes,
+        profileKeepsCpuGeometry(profile) ? nullptr : &data.nodes);
+    if (!data.nodes.empty())
+        for (unsigned int a = 0; a < scene->mNumAnimations; ++a)
+            data.clips.push_back(loadClip(scene->mAnimations[a], data.nodes));
+    importer.FreeScene();
+
+    data.blobs.clear();
+    data.blobs.reserve(data.meshes.size());
+    for (const auto& m : data.meshes)
+        data.blobs.push_back({ m.vertices.data(), m.vertices.size(),
+            m.indices.data(), m.indices.size() });
+    data.bounds = MeshCache::computeBounds(data.blobs, sizeof(Vertex));
+    // The cache holds model-space blobs only, so models with animated nodes
+    // are always imported
+    if (data.nodes.empty() &&
+        !MeshCache::store(path, importFlags, sizeof(Vertex), data.blobs, data.bounds))
+        std::cerr << "WARNING::MESH_CACHE::could not write cache for " << path << std::endl;
+    computeMeshBounds(data);
+    computeOccluder(data);
+    finishStats(data, start);
+    data.ok = true;
+    return data;
+}
+
+// Offset of the indices inside a mesh's staging region (vertices come first)
+inline size_t stagedIndexOffset(size_t vertexBytes) {
+    return MeshCache::align16(vertexBytes);
+}
+
+// Still CPU phase, any thread: copies the geometry into the persistently
+// mapped staging ring so the GL phase only records buffer-to-buffer copies.
+// Meshes that do not fit right now stay unstaged and are uploaded directly.
+inline void stageModel(ModelData& data, UploadRing& ring) {
+    if (!data.ok || !ring.enabled())
+        return;
+    if (!data.gltf.primitives.empty()) {
+        data.staged.resize(data.gltf.views.size());
+        for (size_t i = 0; i < data.gltf.views.size(); ++i) {
+            const Gltf::BufferView& view = data.gltf.views[i];
+            if (!view.used)
+                continue;
+            data.staged[i] = ring.reserve(view.size);
+            if (data.staged[i])
+                std::memcpy(data.staged[i].ptr, view.data, view.size);
+        }
+        return;
+    }
+    const size_t stride = vertexStride(data.vertexFormat);
+    data.staged.resize(data.blobs.size());
+    for (size_t i = 0; i < data.blobs.size(); ++i) {
+        const MeshCache::MeshBlob& b = data.blobs[i];
+        const size_t indexOffset = stagedIndexOffset(b.vertexCount * stride);
+        data.staged[i] = ring.reserve(indexOffset + b.indexCount * sizeof(unsigned int));
+        if (!data.staged[i])
+            continue;
+        std::memcpy(data.staged[i].ptr, b.vertices, b.vertexCount * stride);
+        std::memcpy(data.staged[i].ptr + indexOffset, b.indices, b.indexCount * sizeof(unsigned int));
+    }
+}
+
+// Mesh that owns its VAO/VBO/EBO, or a slot in the shared MeshArena once
+// that is initialized. Move-only; the GL objects (or the slot) are released
+// in the destructor, so meshes must be destroyed on the context thread.
+// The CPU-side geometry is dropped after upload unless the caller asks to
+// keep it (physics, picking).
+class Mesh {
+public:
+    std::vector<Vertex>       vertices;   // empty unless kept
+    std::vector<unsigned int> indices;    // empty unless kept
+    // glTF node matrix, the dequantization of a compiled mesh or the bind
+    // pose of an animated node; kept `vertices` are in model space, or in
+    // the node's space when `node` is set
+    glm::mat4                 transform = glm::mat4(1.0f);
+    bool                      hasTransform = false;
+    int                       node = -1;   // index into Model::getNodes()
+    // Box of the vertices in their own space (before `transform`), for
+    // culling; meshes without one are never culled
+    glm::vec3                 boundsMin = glm::vec3(0.0f);
+    glm::vec3                 boundsMax = glm::vec3(0.0f);
+    bool                      hasBounds = false;
+
+    Mesh(MeshData&& data, bool keepCpuData = false) {
+        setupMesh(data.vertices.data(), data.vertices.size(),
+            data.indices.data(), data.indices.size());
+        if (keepCpuData) {
+            vertices = std::move(data.vertices);
+            indices = std::move(data.indices);
+        }
+    }
+
+    // Uploads straight from external memory (e.g. a mapped cache file).
+    // Quantized blobs are not kept here; the Model dequantizes them.
+    Mesh(const MeshCache::MeshBlob& blob, VertexFormat format, bool keepCpuData = false) {
+        setupMesh(blob.vertices, blob.vertexCount, blob.indices, blob.indexCount, format);
+        if (keepCpuData && format == VertexFormat::Float)
+            keepBlob(blob);
+    }
+
+    // Fills fresh immutable buffers from a region written by stageModel();
+    // the data lands once the GPU has executed the ring's copies
+    Mesh(const MeshCache::MeshBlob& blob, VertexFormat format, const StagingRegion& region,
+         UploadRing& ring, bool keepCpuData = false) {
+        const size_t vertexBytes = blob.vertexCount * vertexStride(format);
+        if (!setupMesh(nullptr, blob.vertexCount, nullptr, blob.indexCount, format)) {
+            ring.cancel(region);
+            return;
+        }
+        ring.copy(region, 0, vertexBytes, vertexBuffer(), vertexOffset());
+        ring.copy(region, stagedIndexOffset(vertexBytes),
+            blob.indexCount * sizeof(unsigned int), indexBuffer(), indexByteOffset());
+        if (keepCpuData && format == VertexFormat::Float)
+            keepBlob(blob);
+    }
+
+    // Draws out of buffers owned by the Model (glTF bufferViews); only the
+    // VAO belongs to the mesh. `transform` is the node's model-space matrix.
+    Mesh(const Gltf::Primitive& prim, const std::vector<GLuint>& viewBuffers)
+        : transform(prim.transform), hasTransform(prim.transform != glm::mat4(1.0f)) {
+        indexCount = static_cast<GLsizei>(prim.indexCount);
+        indexType = static_cast<GLenum>(prim.indexType);
+        indexOffset = prim.indexOffset;
+        glGenVertexArrays(1, &VAO);
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, viewBuffers[prim.indexView]);
+        glBindBuffer(GL_ARRAY_BUFFER, viewBuffers[prim.positionView]);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, prim.positionStride,
+            reinterpret_cast<void*>(prim.positionOffset));
+        glBindBuffer(GL_ARRAY_BUFFER, viewBuffers[prim.normalView]);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, prim.normalStride,
+            reinterpret_cast<void*>(prim.normalOffset));
+        glBindVertexArray(0);
+    }
+
+    ~Mesh() { release(); }
+
+    Mesh(const Mesh&) = delete;
+    Mesh& operator=(const Mesh&) = delete;
+
+    Mesh(Mesh&& other) noexcept
+        : vertices(std::move(other.vertices)), indices(std::move(other.indices)),
+          transform(other.transform), hasTransform(other.hasTransform), node(other.node),
+          boundsMin(other.boundsMin), boundsMax(other.boundsMax), hasBounds(other.hasBounds),
+          VAO(other.VAO), VBO(other.VBO), EBO(other.EBO), indexCount(other.indexCount),
+          indexType(other.indexType), indexOffset(other.indexOffset), slot(other.slot),
+          outOfSpace(other.outOfSpace) {
+        other.VAO = other.VBO = other.EBO = 0;
+        other.indexCount = 0;
+        other.slot.valid = false;
+    }
+
+    Mesh& operator=(Mesh&& other) noexcept {
+        if (this != &other) {
+            release();
+            vertices = std::move(other.vertices);
+            indices = std::move(other.indices);
+            transform = other.transform;
+            hasTransform = other.hasTransform;
+            node = other.node;
+            boundsMin = other.boundsMin;
+            boundsMax = other.boundsMax;
+            hasBounds = other.hasBounds;
+            VAO = other.VAO;
+            VBO = other.VBO;
+            EBO = other.EBO;
+            indexCount = other.indexCount;
+            indexType = other.indexType;
+            indexOffset = other.indexOffset;
+            slot = other.slot;
+            outOfSpace = other.outOfSpace;
+            other.VAO = other.VBO = other.EBO = 0;
+            other.indexCount = 0;
+            other.slot.valid = false;
+        }
+        return *this;
+    }
+
+    void setBounds(const MeshCache::Bounds& b) {
+        if (b.empty())
+            return;
+        boundsMin = glm::make_vec3(b.min);
+        boundsMax = glm::make_vec3(b.max);
+        hasBounds = true;
+    }
+
+    bool    hasCpuData()    const { return !vertices.empty(); }
+    GLsizei getIndexCount() const { return indexCount; }
+    // Bytes in this mesh's own buffers or arena slot (glTF meshes share
+    // the Model's)
+    size_t  gpuBytes()      const {
+        if (slot.valid) {
+            const MeshArena::Range& r = MeshArena::range(slot);
+            return r.vertexCount * MeshArena::arena(slot.format).stride() +
+                   r.indexCount * sizeof(unsigned int);
+        }
+        return GpuMemory::bytesOf(GpuMemory::Kind::Buffer, VBO) +
+               GpuMemory::bytesOf(GpuMemory::Kind::Buffer, EBO);
+    }
+    // Placement in the shared arena; invalid for meshes with own buffers
+    const MeshArena::Slot& arenaSlot() const { return slot; }
+    // The arena had no room for the mesh within its limit; nothing was
+    // uploaded and it must not be drawn
+    bool    isOutOfSpace()  const { return outOfSpace; }
+
+    void Draw() const {
+        if (slot.valid) {
+            glBindVertexArray(MeshArena::arena(slot.format).vertexArray());
+            glDrawElementsBaseVertex(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT,
+                reinterpret_cast<void*>(indexByteOffset()), GLint(MeshArena::range(slot).baseVertex));
+            glBindVertexArray(0);
+            return;
+        }
+        glBindVertexArray(VAO);
+        glDrawElements(GL_TRIANGLES,
+            indexCount,
+            indexType, reinterpret_cast<void*>(indexOffset));
+        glBindVertexArray(0);
+    }
+
+private:
+    unsigned int VAO = 0, VBO = 0, EBO = 0;
+    GLsizei      indexCount = 0;
+    GLenum       indexType = GL_UNSIGNED_INT;
+    size_t       indexOffset = 0;
+    MeshArena::Slot slot;
+    bool         outOfSpace = false;
+
+    void release() {
+        if (slot.valid && MeshArena::enabled())
+            MeshArena::arena(slot.format).release(slot);
+        slot.valid = false;
+        if (VAO) glDeleteVertexArrays(1, &VAO);
+        GpuMemory::deleteBuffer(VBO);
+        GpuMemory::deleteBuffer(EBO);
+        VAO = 0;
+        indexCount = 0;
+    }
+
+    void keepBlob(const MeshCache::MeshBlob& blob) {
+        const Vertex* verts = static_cast<const Vertex*>(blob.vertices);
+        vertices.assign(verts, verts + blob.vertexCount);
+        indices.assign(blob.indices, blob.indices + blob.indexCount);
+    }
+
+    GLuint vertexBuffer() const { return slot.valid ? MeshArena::arena(slot.format).vertexBuffer() : VBO; }
+    GLuint indexBuffer()  const { return slot.valid ? MeshArena::arena(slot.format).indexBuffer() : EBO; }
+    size_t vertexOffset() const {
+        return slot.valid ? MeshArena::range(slot).baseVertex * MeshArena::arena(slot.format).stride() : 0;
+    }
+    size_t indexByteOffset() const {
+        return slot.valid ? MeshArena::range(slot).firstIndex * sizeof(unsigned int) : 0;
+    }
+
+    // False if the arena refused the mesh (see isOutOfSpace())
+    bool setupMesh(const void* verts, size_t vertCount,
+                   const unsigned int* inds, size_t indCount,
+                   VertexFormat format = VertexFormat::Float) {
+        // Null verts/inds only allocate; the staging ring fills them later
+        indexCount = static_cast<GLsizei>(indCount);
+        if (MeshArena::enabled()) {
+            // Indices stay relative to the mesh; baseVertex offsets them
+            MeshArena::Arena& arena = MeshArena::arena(format == VertexFormat::Quantized
+                ? MeshArena::Format::Quantized : MeshArena::Format::Float);
+            if (!arena.allocate(vertCount, indCount, slot)) {
+                outOfSpace = true;
+                return false;
+            }
+            if (verts) {
+                glBindBuffer(GL_ARRAY_BUFFER, arena.vertexBuffer());
+                glBufferSubData(GL_ARRAY_BUFFER, GLintptr(vertexOffset()),
+                    GLsizeiptr(vertCount * vertexStride(format)), verts);
+            }
+            if (inds) {
+                glBindBuffer(GL_COPY_WRITE_BUFFER, arena.indexBuffer());
+                glBufferSubData(GL_COPY_WRITE_BUFFER, GLintptr(indexByteOffset()),
+                    GLsizeiptr(indCount * sizeof(unsigned int)), inds);
+            }
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            return true;
+        }
+        glGenVertexArrays(1, &VAO);
+        glBindVertexArray(VAO);
+        VBO = createStaticBuffer(GL_ARRAY_BUFFER, vertCount * vertexStride(format), verts);
+        EBO = createStaticBuffer(GL_ELEMENT_ARRAY_BUFFER, indCount * sizeof(unsigned int), inds);
+
+        if (format == VertexFormat::Quantized) {
+            // unorm16 position in [0,1]^3, snorm 10:10:10:2 normal; the
+            // Model supplies the matching dequantization transform
+            const GLsizei stride = sizeof(CompiledAsset::QuantizedVertex);
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, stride,
+                reinterpret_cast<void*>(offsetof(CompiledAsset::QuantizedVertex, position)));
+            glEnableVertexAttribArray(1);
+            glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride,
+                reinterpret_cast<void*>(offsetof(CompiledAsset::QuantizedVertex, normal)));
+            glBindVertexArray(0);
+            return true;
+        }
+
+        // Position attribute
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE,
+            sizeof(Vertex),
+            reinterpret_cast<void*>(offsetof(Vertex, Position)));
+        // Normal attribute
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE,
+            sizeof(Vertex),
+            reinterpret_cast<void*>(offsetof(Vertex, Normal)));
+
+        glBindVertexArray(0);
+        return true;
+    }
+};
+
+// Model loader using Assimp
+class Model {
+public:
+    std::vector<Mesh> meshes;
+
+    // keepCpuGeometry: keep vertices/indices in each Mesh after upload
+    explicit Model(bool keepCpuGeometry = false) : keepCpuGeometry(keepCpuGeometry) {}
+
+    // Synchronous load: both phases on the calling (GL context) thread
+    Model(const std::string& path, ImportProfile profile = ImportProfile::RenderOptimized,
+          bool keepCpuGeometry = false)
+        : keepCpuGeometry(keepCpuGeometry || profileKeepsCpuGeometry(profile)) {
+        Assimp::Importer importer;
+        upload(importModel(path, importer, profile));
+    }
+
+    ~Model() { release(); }
+
+    Model(const Model&) = delete;
+    Model& operator=(const Model&) = delete;
+
+    // GL phase: must run on the thread that owns the context. Staged meshes
+    // are copied out of the ring and the model becomes ready once that copy's
+    // fence signals (pollUpload()). Otherwise freshly imported geometry is
+    // moved into the meshes (and freed after upload unless kept) and mapped
+    // cache data is uploaded in place.
+    void upload(ModelData&& data, UploadRing* ring = nullptr) {
+        path = data.path;
+        stats = data.stats;
+        if (!data.bounds.empty())
+            setBounds(data.bounds);
+        if (!data.ok) {
+            failed = true;
+            return;
+        }
+        const auto start = std::chrono::steady_clock::now();
+        const bool staged = ring && !data.staged.empty();
+        if (!data.gltf.primitives.empty())
+            uploadGltf(data.gltf, data.staged, ring, data.meshBounds);
+        meshes.reserve(meshes.size() + data.blobs.size());
+        const VertexFormat format = data.vertexFormat;
+        nodes = std::move(data.nodes);
+        clips = std::move(data.clips);
+        occluder = std::move(data.occluder);
+        for (size_t i = 0; i < data.blobs.size(); ++i) {
+            const MeshCache::MeshBlob& b = data.blobs[i];
+            const int node = i < data.meshes.size() ? data.meshes[i].node : -1;
+            if (staged && data.staged[i])
+                meshes.emplace_back(b, format, data.staged[i], *ring, keepCpuGeometry);
+            else if (!data.meshes.empty())
+                meshes.emplace_back(std::move(data.meshes[i]), keepCpuGeometry);
+            else
+                meshes.emplace_back(b, format, keepCpuGeometry);
+            if (format == VertexFormat::Quantized)
+                dequantizeMesh(meshes.back(), b, data.bounds);
+            if (i < data.meshBounds.size())
+                meshes.back().setBounds(data.meshBounds[i]);
+            attachToNode(meshes.back(), node);
+        }
+        // The arenas are full up to the budget: stay evicted (the proxy
+        // keeps drawing) until the owner makes room and asks again
+        if (anyOutOfSpace()) {
+            evictedSize = 0;
+            for (const MeshCache::MeshBlob& b : data.blobs)
+                evictedSize += b.vertexCount * vertexStride(format) + b.indexCount * sizeof(unsigned int);
+            data.blobs.clear();
+            if (ring)
+                ring->submit();   // covers the copies already issued
+            release();
+            evicted = true;
+            return;
+        }
+        data.blobs.clear();
+        uploadFence = ring ? ring->submit() : nullptr;
+        stats.uploadMs = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start).count();
+        ready = !uploadFence;
+        ++residencyCounter();
+    }
+
+    // Context thread: true once no staged copy is outstanding, at which point
+    // the model is ready. With wait, blocks on the copy fence.
+    bool pollUpload(bool wait = false) {
+        if (uploadFence && uploadFence->poll(wait)) {
+            uploadFence.reset();
+            ready = true;
+            ++residencyCounter();
+        }
+        return !uploadFence;
+    }
+
+    // Frees the GL objects (and any kept CPU geometry)
+    void release() {
+        meshes.clear();
+        for (GLuint& buffer : sharedBuffers)
+            GpuMemory::deleteBuffer(buffer);
+        sharedBuffers.clear();
+        uploadFence.reset();
+        ready = false;
+        ++residencyCounter();
+    }
+
+    // Residency (see ModelCache): bytes held in this model's GL buffers
+    size_t gpuBytes() const {
+        size_t bytes = 0;
+        for (const auto& mesh : meshes)
+            bytes += mesh.gpuBytes();
+        for (GLuint buffer : sharedBuffers)
+            bytes += GpuMemory::bytesOf(GpuMemory::Kind::Buffer, buffer);
+        return bytes;
+    }
+
+    // Marks the model as wanted this frame; Draw() does it implicitly, a
+    // caller drawing a proxy instead should do it by hand
+    void touch() const { drawn = true; }
+    bool takeDrawn() {
+        const bool d = drawn;
+        drawn = false;
+        return d;
+    }
+
+    // Frees the GL buffers and leaves the model not ready. Geometry kept on
+    // the CPU is parked so restoreFromCpu() can rebuild the buffers without
+    // I/O; otherwise the owner reloads it through the loader, which hits the
+    // compiled or cached file on disk.
+    void evict() {
+        if (!ready)
+            return;
+        bool cpu = keepCpuGeometry && sharedBuffers.empty() && !meshes.empty();
+        for (const auto& mesh : meshes)
+            cpu = cpu && mesh.hasCpuData();
+        parked.clear();
+        if (cpu)
+            park();
+        evictedSize = gpuBytes();
+        release();
+        evicted = true;
+    }
+    bool isEvicted()         const { return evicted; }
+    bool canRestoreFromCpu() const { return !parked.empty(); }
+    // Bytes the model held when it was evicted (what it needs to come back)
+    size_t evictedBytes()    const { return evictedSize; }
+
+    // Context thread: re-uploads parked CPU geometry. False if the arenas
+    // have no room for it; the model then stays evicted, still parked.
+    bool restoreFromCpu() {
+        meshes.reserve(parked.size());
+        for (auto& data : parked) {
+            const int node = data.node;
+            MeshCache::Bounds b;
+            for (const Vertex& v : data.vertices)
+                b.add(&v.Position.x);
+            meshes.emplace_back(std::move(data), true);
+            meshes.back().setBounds(b);
+            attachToNode(meshes.back(), node);
+        }
+        parked.clear();
+        if (anyOutOfSpace()) {
+            park();
+            release();
+            return false;
+        }
+        evicted = false;
+        ready = true;
+        ++residencyCounter();
+        return true;
+    }
+
+    // The owner has asked the loader for the geometry again
+    void markReloading() { evicted = false; }
+
+    // False until the GL phase has run and its copies have landed (async
+    // loads draw nothing until then)
+    bool isReady()     const { return ready; }
+    // Changes whenever any model becomes ready or frees its buffers, so a
+    // caller caching what is drawable (DrawBatch's resident set) can tell
+    // when to look again
+    static uint64_t residencyVersion() { return residencyCounter(); }
+    bool hasFailed()   const { return failed; }
+    bool keepsCpuData() const { return keepCpuGeometry; }
+
+    // Model-space box, known before the geometry when the cache has it; the
+    // renderer draws it as a proxy while the model is not ready
+    void setBounds(const MeshCache::Bounds& b) {
+        boundsMin = glm::make_vec3(b.min);
+        boundsMax = glm::make_vec3(b.max);
+        boundsKnown = true;
+    }
+    bool             hasBounds()    const { return boundsKnown; }
+    const glm::vec3& getBoundsMin() const { return boundsMin; }
+    const glm::vec3& getBoundsMax() const { return boundsMax; }
+
+    const std::string& getPath()  const { return path; }
+    const ModelStats&  getStats() const { return stats; }
+    // Animated nodes kept by the import (empty for fully baked models) and
+    // the clips that drive them
+    const std::vector<NodeData>&      getNodes() const { return nodes; }
+    const std::vector<AnimationClip>& getClips() const { return clips; }
+    // Largest static triangles in model space (see computeOccluder()); kept
+    // while the model is evicted, as it is small
+    const std::vector<glm::vec3>&     getOccluder() const { return occluder; }
+
+    // Draws every mesh with `objectMatrix` in the model uniform, combined
+    // with the mesh's own node transform where it has one. `nodeMatrices`
+    // (one model-space matrix per getNodes() entry, see AnimationSystem)
+    // replaces the bind pose of animated nodes.
+    void Draw(GLint modelLoc, const glm::mat4& objectMatrix, const glm::mat4* nodeMatrices = nullptr) const {
+        touch();
+        if (!ready)
+            return;
+        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(objectMatrix));
+        bool dirty = false;
+        for (const auto& mesh : meshes) {
+            if (mesh.hasTransform) {
+                glm::mat4 m = objectMatrix * meshTransform(mesh, nodeMatrices);
+                glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(m));
+                dirty = true;
+            }
+            else if (dirty) {
+                glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(objectMatrix));
+                dirty = false;
+            }
+            mesh.Draw();
+        }
+    }
+
+    // Same as Draw(), but hands each mesh and its final model matrix to `f`
+    // instead of drawing (see DrawBatch)
+    template <typename F>
+    void forEachMesh(const glm::mat4& objectMatrix, const glm::mat4* nodeMatrices, F&& f) const {
+        touch();
+        if (!ready)
+            return;
+        for (const auto& mesh : meshes)
+            f(mesh, mesh.hasTransform ? objectMatrix * meshTransform(mesh, nodeMatrices) : objectMatrix);
+    }
+
+private:
+    static uint64_t& residencyCounter() {
+        static uint64_t counter = 0;
+        return counter;
+    }
+
+    static const glm::mat4& meshTransform(const Mesh& mesh, const glm::mat4* nodeMatrices) {
+        return nodeMatrices && mesh.node >= 0 ? nodeMatrices[mesh.node] : mesh.transform;
+    }
+
+    bool anyOutOfSpace() const {
+        for (const auto& mesh : meshes)
+            if (mesh.isOutOfSpace())
+                return true;
+        return false;
+    }
+
+    // Moves the meshes' kept CPU geometry to `parked`
+    void park() {
+        for (auto& mesh : meshes)
+            parked.push_back({ std::move(mesh.vertices), std::move(mesh.indices), mesh.node });
+    }
+
+    // Places a mesh of an animated node at the node's bind pose
+    void attachToNode(Mesh& mesh, int node) const {
+        if (node < 0)
+            return;
+        glm::mat4 m(1.0f);
+        for (int n = node; n >= 0; n = nodes[size_t(n)].parent)
+            m = nodes[size_t(n)].offset * nodes[size_t(n)].local * m;
+        mesh.node = node;
+        mesh.transform = m;
+        mesh.hasTransform = true;
+    }
+
+    // Quantized meshes draw through translate(min) * scale(extent); a flat
+    // axis keeps scale 1 so the normal matrix stays invertible
+    void dequantizeMesh(Mesh& mesh, const MeshCache::MeshBlob& blob,
+                        const MeshCache::Bounds& bounds) const {
+        glm::vec3 lo = glm::make_vec3(bounds.min);
+        glm::vec3 extent = glm::make_vec3(bounds.max) - lo;
+        for (int k = 0; k < 3; ++k)
+            if (extent[k] <= 0.0f)
+                extent[k] = 1.0f;
+        mesh.transform = glm::scale(glm::translate(glm::mat4(1.0f), lo), extent);
+        mesh.hasTransform = true;
+        if (!keepCpuGeometry)
+            return;
+        const auto* q = static_cast<const CompiledAsset::QuantizedVertex*>(blob.vertices);
+        mesh.vertices.resize(blob.vertexCount);
+        for (size_t i = 0; i < blob.vertexCount; ++i)
+            CompiledAsset::dequantize(q[i], bounds,
+                &mesh.vertices[i].Position.x, &mesh.vertices[i].Normal.x);
+        mesh.indices.assign(blob.indices, blob.indices + blob.indexCount);
+    }
+
+    // One GL buffer per used glTF bufferView, copied from its staging region
+    // or uploaded straight from the mapped .bin; the primitives' VAOs point
+    // into them
+    void uploadGltf(const Gltf::Asset& asset, const std::vector<StagingRegion>& staged,
+                    UploadRing* ring, const std::vector<MeshCache::Bounds>& meshBounds) {
+        std::vector<GLuint> viewBuffers(asset.views.size(), 0);
+        for (size_t i = 0; i < asset.views.size(); ++i) {
+            const Gltf::BufferView& view = asset.views[i];
+            if (!view.used)
+                continue;
+            if (ring && i < staged.size() && staged[i]) {
+                viewBuffers[i] = createStaticBuffer(GL_ARRAY_BUFFER, view.size, nullptr);
+                ring->copy(staged[i], 0, view.size, viewBuffers[i], 0);
+            }
+            else {
+                viewBuffers[i] = createStaticBuffer(GL_ARRAY_BUFFER, view.size, view.data);
+            }
+            sharedBuffers.push_back(viewBuffers[i]);
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        meshes.reserve(meshes.size() + asset.primitives.size());
+        for (size_t i = 0; i < asset.primitives.size(); ++i) {
+            meshes.emplace_back(asset.primitives[i], viewBuffers);
+            if (i < meshBounds.size())
+                meshes.back().setBounds(meshBounds[i]);
+        }
+    }
+
+    std::vector<GLuint> sharedBuffers;
+    UploadFenceRef      uploadFence;   // pending staged copies
+    glm::vec3           boundsMin = glm::vec3(0.0f);
+    glm::vec3           boundsMax = glm::vec3(0.0f);
+    bool                boundsKnown = false;
+    std::string path;
+    ModelStats  stats;
+    bool keepCpuGeometry = false;
+    bool ready  = false;
+    bool failed = false;
+    bool evicted = false;
+    size_t evictedSize = 0;
+    mutable bool          drawn = false;
+    std::vector<MeshData> parked;   // CPU geometry of an evicted model
+    std::vector<NodeData>      nodes;
+    std::vector<AnimationClip> clips;
+    std::vector<glm::vec3>     occluder;
+};
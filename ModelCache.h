@@ -0,0 +1,214 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+
+#include "GpuMemory.h"
+#include "MeshCache.h"
+#include "Model.h"
+#include "ModelLoader.h"
+
+// Shared handle to a loaded model. The GL buffers are freed when the last
+// handle goes away, so handles must be dropped on the context thread.
+using ModelHandle = std::shared_ptr<Model>;
+
+// Deduplicates model loads: every request for the same file (by canonical
+// path) with the same import profile returns the same Model, so many scene
+// objects can share one import and one set of VBOs.
+//
+// With a GPU budget set, it also manages residency: when the asset bytes in
+// use exceed the budget, the least recently drawn models are evicted (see
+// Model::evict()). An evicted model that is drawn again (or touch()ed while
+// its proxy is drawn) is brought back the next update(), from parked CPU
+// geometry or through the loader, as soon as it fits. The mesh arenas are
+// held to the same budget, so a model they cannot place stays evicted.
+class ModelCache {
+public:
+    explicit ModelCache(ModelLoader& loader) : loader(loader) {}
+
+    ModelCache(const ModelCache&) = delete;
+    ModelCache& operator=(const ModelCache&) = delete;
+
+    // Returns a handle immediately; the model is imported on the loader's
+    // workers and stays !isReady() until a later update() uploads it. If the
+    // mesh cache already has the file, its bounds are set right away so a
+    // proxy can be drawn. keepCpuGeometry keeps vertices/indices resident
+    // for picking (the physics profile always keeps them).
+    ModelHandle loadAsync(const std::string& path,
+                          ImportProfile profile = ImportProfile::RenderOptimized,
+                          bool keepCpuGeometry = false, float priority = 0.0f) {
+        keepCpuGeometry = keepCpuGeometry || profileKeepsCpuGeometry(profile);
+        const std::string key = makeKey(path, profile, keepCpuGeometry);
+        auto it = entries.find(key);
+        if (it != entries.end()) {
+            if (ModelHandle existing = it->second.model.lock()) {
+                prioritize(existing, priority);
+                return existing;
+            }
+        }
+        ModelHandle model = std::make_shared<Model>(keepCpuGeometry);
+        MeshCache::Bounds bounds;
+        if (MeshCache::peekBounds(path, importFlagsFor(profile), sizeof(Vertex), bounds))
+            model->setBounds(bounds);
+        entries[key] = { model, path, profile, frame, false };
+        loader.request(model, path, profile, priority);
+        return model;
+    }
+
+    // Blocking variant: returns once the model is uploaded (or has failed)
+    ModelHandle load(const std::string& path,
+                     ImportProfile profile = ImportProfile::RenderOptimized,
+                     bool keepCpuGeometry = false) {
+        ModelHandle model = loadAsync(path, profile, keepCpuGeometry);
+        while (!model->isReady() && !model->hasFailed() && !model->isEvicted())
+            loader.waitAndUpload();
+        return model;
+    }
+
+    // Lower priority values load and upload first (see ModelLoader)
+    void prioritize(const ModelHandle& model, float priority) {
+        if (model && !model->isReady())
+            loader.prioritize(model, priority);
+    }
+
+    // Context thread, once per frame: uploads finished imports (within
+    // uploadBudgetMs if non-zero), forgets entries whose models have been
+    // released and, with a budget, evicts and restores models
+    void update(double uploadBudgetMs = 0.0) {
+        loader.uploadReady(false, uploadBudgetMs);
+        ++frame;
+        for (auto it = entries.begin(); it != entries.end();) {
+            if (ModelHandle m = it->second.model.lock()) {
+                if (m->takeDrawn())
+                    it->second.lastDrawn = frame - 1;
+                ++it;
+            }
+            else {
+                it = entries.erase(it);
+            }
+        }
+        if (budgetBytes)
+            enforceBudget();
+    }
+
+    // Hard cap on GpuMemory::assetBytes(); 0 disables eviction
+    void setBudget(size_t bytes) {
+        budgetBytes = bytes;
+        MeshArena::limit() = bytes;
+    }
+    size_t budget() const { return budgetBytes; }
+    size_t evictionCount() const { return evictions; }
+
+    size_t size() const { return entries.size(); }
+
+    // Per-model load stats followed by totals per import profile
+    void printStats(std::ostream& out) const {
+        struct Totals { size_t models = 0, vertices = 0, draws = 0; double ms = 0.0; };
+        std::map<ImportProfile, Totals> totals;
+        for (const auto& e : entries) {
+            ModelHandle m = e.second.model.lock();
+            if (!m || !m->isReady())
+                continue;
+            const ModelStats& st = m->getStats();
+            out << "  " << m->getPath() << " [" << profileName(st.profile)
+                << (st.compiled ? ", compiled" : st.fromCache ? ", cached" : "") << "] "
+                << st.importMs + st.uploadMs << " ms, "
+                << st.vertexCount << " vertices, "
+                << st.drawCount << " draws\n";
+            Totals& t = totals[st.profile];
+            ++t.models;
+            t.vertices += st.vertexCount;
+            t.draws += st.drawCount;
+            t.ms += st.importMs + st.uploadMs;
+        }
+        for (const auto& t : totals)
+            out << "  " << profileName(t.first) << ": " << t.second.models << " models, "
+                << t.second.ms << " ms, " << t.second.vertices << " vertices, "
+                << t.second.draws << " draws\n";
+        GpuMemory::print(out);
+        if (budgetBytes)
+            out << "  budget " << budgetBytes / (1024 * 1024) << " MB, "
+                << evictions << " evictions\n";
+        out.flush();
+    }
+
+private:
+    struct Entry {
+        std::weak_ptr<Model> model;
+        std::string          path;
+        ImportProfile        profile = ImportProfile::RenderOptimized;
+        uint64_t             lastDrawn = 0;   // update() frame
+        bool                 reloading = false;   // requested from the loader again
+    };
+
+    // Brings back evicted models that were wanted last frame, most recently
+    // drawn first, then evicts models not drawn last frame, least recently
+    // drawn first, until the bytes in use fit. A reload that would not fit
+    // even after that stays evicted (its proxy keeps drawing). Free arena
+    // space is not counted: it is reused before an arena grows, and an
+    // arena shrinks once mostly empty.
+    void enforceBudget() {
+        struct Candidate { Entry* entry; ModelHandle model; };
+        std::vector<Candidate> idle, wanted;
+        size_t inFlight = 0;   // reloads not uploaded yet, at their old size
+        for (auto& e : entries) {
+            ModelHandle m = e.second.model.lock();
+            if (e.second.reloading && (m->isReady() || m->hasFailed() || m->isEvicted()))
+                e.second.reloading = false;
+            if (e.second.reloading)
+                inFlight += m->evictedBytes();
+            else if (m->isEvicted() && e.second.lastDrawn == frame - 1)
+                wanted.push_back({ &e.second, m });
+            else if (m->isReady() && e.second.lastDrawn < frame - 1)
+                idle.push_back({ &e.second, m });
+        }
+        auto byLastDrawn = [](const Candidate& a, const Candidate& b) {
+            return a.entry->lastDrawn < b.entry->lastDrawn;
+        };
+        std::sort(idle.begin(), idle.end(), byLastDrawn);
+        auto next = idle.begin();
+        auto evictUntil = [&](size_t limit) {
+            for (; usedBytes() + inFlight > limit && next != idle.end(); ++next) {
+                next->model->evict();
+                ++evictions;
+            }
+        };
+
+        for (const Candidate& c : wanted) {
+            const size_t need = c.model->evictedBytes();
+            if (need <= budgetBytes)
+                evictUntil(budgetBytes - need);
+            if (usedBytes() + inFlight + need > budgetBytes)
+                continue;
+            if (c.model->canRestoreFromCpu()) {
+                c.model->restoreFromCpu();   // stays evicted if the arenas refuse it
+            }
+            else {
+                c.model->markReloading();
+                c.entry->reloading = true;
+                inFlight += need;
+                loader.request(c.model, c.entry->path, c.entry->profile, 0.0f);
+            }
+        }
+        evictUntil(budgetBytes);
+    }
+
+    static size_t usedBytes() { return GpuMemory::assetBytes() - MeshArena::unusedBytes(); }
+
+    static std::string makeKey(const std::string& path, ImportProfile profile,
+                               bool keepCpuGeometry) {
+        return MeshCache::canonicalPath(path) + '|' + profileName(profile) +
+            (keepCpuGeometry ? "|cpu" : "");
+    }
+
+    ModelLoader&                           loader;
+    std::unordered_map<std::string, Entry> entries;
+    uint64_t                               frame = 1;
+    size_t                                 budgetBytes = 0;
+    size_t                                 evictions = 0;
+};
@@ -0,0 +1,226 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Model.h"
+
+// Loads models in two phases: the CPU phase (cache lookup / Assimp import /
+// processMesh) runs on a pool of worker threads, each with its own
+// Assimp::Importer; finished results are queued and the GL phase
+// (Mesh::setupMesh) is drained by the context thread in uploadReady().
+// With an enabled UploadRing the workers also stage the geometry, so the
+// context thread only records GPU copies and later polls their fences.
+// Jobs carry a priority (lower first): workers take the most urgent queued
+// import and uploadReady() uploads finished ones in the same order.
+class ModelLoader {
+public:
+    explicit ModelLoader(UploadRing* ring = nullptr,
+                         unsigned threadCount = std::thread::hardware_concurrency())
+        : ring(ring) {
+        threadCount = std::max(1u, threadCount);
+        for (unsigned i = 0; i < threadCount; ++i)
+            workers.emplace_back([this] { workerLoop(); });
+    }
+
+    ~ModelLoader() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        jobReady.notify_all();
+        for (auto& t : workers)
+            t.join();
+    }
+
+    ModelLoader(const ModelLoader&) = delete;
+    ModelLoader& operator=(const ModelLoader&) = delete;
+
+    // Queues `path` for import; `target` is filled in by a later uploadReady().
+    // The loader only holds a weak reference: if every handle to `target` is
+    // dropped before the import starts, the job is cancelled; if it is
+    // dropped later, the result is discarded.
+    void request(const std::shared_ptr<Model>& target, const std::string& path,
+                 ImportProfile profile = ImportProfile::RenderOptimized, float priority = 0.0f) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobs.push_back({ target, path, profile, priority });
+            ++pending;
+        }
+        jobReady.notify_one();
+    }
+
+    // Raises the priority of a queued or finished-but-not-uploaded load to
+    // `priority` if that is more urgent than what it has
+    void prioritize(const std::shared_ptr<Model>& target, float priority) {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto& j : jobs)
+            if (j.target.lock() == target)
+                j.priority = std::min(j.priority, priority);
+        for (auto& r : results)
+            if (r.target.lock() == target)
+                r.priority = std::min(r.priority, priority);
+    }
+
+    // While paused, workers take no new jobs; lets a caller queue a batch
+    // and prioritize it before any of it starts
+    void pause() {
+        std::lock_guard<std::mutex> lock(mutex);
+        paused = true;
+    }
+    void resume() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            paused = false;
+        }
+        jobReady.notify_all();
+    }
+
+    // GL phase: uploads finished imports, most urgent first, and retires
+    // completed staging copies. Context thread only. A non-zero budget stops
+    // uploading once that many milliseconds have been spent; the rest waits
+    // for the next call. Returns the number of imports uploaded.
+    size_t uploadReady(bool waitForCopies = false, double budgetMs = 0.0) {
+        const auto start = std::chrono::steady_clock::now();
+        std::deque<Result> ready;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ready.swap(results);
+        }
+        std::stable_sort(ready.begin(), ready.end(),
+            [](const Result& a, const Result& b) { return a.priority < b.priority; });
+        size_t uploaded = 0;
+        for (auto& r : ready) {
+            if (budgetMs > 0.0 && uploaded > 0 &&
+                std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now() - start).count() > budgetMs)
+                break;
+            ++uploaded;
+            if (auto target = r.target.lock()) {
+                target->upload(std::move(r.data), ring);
+                if (!target->isReady() && !target->hasFailed())
+                    copying.push_back(target);
+            }
+            else if (ring) {
+                for (const auto& region : r.data.staged)
+                    if (region)
+                        ring->cancel(region);
+            }
+        }
+        copying.erase(std::remove_if(copying.begin(), copying.end(),
+            [waitForCopies](const std::weak_ptr<Model>& m) {
+                auto model = m.lock();
+                return !model || model->pollUpload(waitForCopies);
+            }), copying.end());
+        if (ring)
+            ring->update();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            // Over budget: the rest goes back ahead of newer results
+            results.insert(results.begin(),
+                std::make_move_iterator(ready.begin() + uploaded),
+                std::make_move_iterator(ready.end()));
+            pending -= uploaded;
+        }
+        return uploaded;
+    }
+
+    // Blocks until at least one import finishes (or nothing is pending),
+    // then uploads everything that is ready. Once every import is in, waits
+    // on the outstanding copy fences instead.
+    size_t waitAndUpload() {
+        bool drained;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            auto done = [this] { return !results.empty() || pending == 0; };
+            if (copying.empty())
+                resultReady.wait(lock, done);
+            else
+                resultReady.wait_for(lock, std::chrono::milliseconds(1), done);
+            drained = pending == 0;
+        }
+        return uploadReady(drained);
+    }
+
+    // Blocks the context thread until every requested model is uploaded,
+    // uploading each one as soon as its import finishes
+    void finish() {
+        while (!idle())
+            waitAndUpload();
+    }
+
+    // Context thread only (the copy list is not shared with the workers)
+    bool idle() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return pending == 0 && copying.empty();
+    }
+
+private:
+    struct Job {
+        std::weak_ptr<Model> target;
+        std::string          path;
+        ImportProfile        profile;
+        float                priority;
+    };
+    struct Result {
+        std::weak_ptr<Model> target;
+        ModelData            data;
+        float                priority;
+    };
+
+    void workerLoop() {
+        // One importer per thread; Assimp::Importer is not thread-safe
+        Assimp::Importer importer;
+        while (true) {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                jobReady.wait(lock, [this] { return stopping || (!paused && !jobs.empty()); });
+                if (stopping)
+                    return;
+                // Cancelled: nobody holds the target any more
+                const size_t before = jobs.size();
+                jobs.erase(std::remove_if(jobs.begin(), jobs.end(),
+                    [](const Job& j) { return j.target.expired(); }), jobs.end());
+                if (jobs.size() != before) {
+                    pending -= before - jobs.size();
+                    resultReady.notify_all();
+                }
+                if (jobs.empty())
+                    continue;
+                auto next = std::min_element(jobs.begin(), jobs.end(),
+                    [](const Job& a, const Job& b) { return a.priority < b.priority; });
+                job = std::move(*next);
+                jobs.erase(next);
+            }
+            ModelData data = importModel(job.path, importer, job.profile);
+            if (ring)
+                stageModel(data, *ring);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                results.push_back({ job.target, std::move(data), job.priority });
+            }
+            resultReady.notify_all();
+        }
+    }
+
+    UploadRing*              ring;
+    std::vector<std::weak_ptr<Model>> copying;   // uploaded, waiting on a copy fence
+    std::vector<std::thread> workers;
+    mutable std::mutex       mutex;
+    std::condition_variable  jobReady;
+    std::condition_variable  resultReady;
+    std::deque<Job>          jobs;
+    std::deque<Result>       results;
+    size_t                   pending = 0;
+    bool                     paused = false;
+    bool                     stopping = false;
+};
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <assimp/anim.h>
+
+// A node kept out of the baked geometry because an animation drives it.
+// Its meshes are in its own space. In the bind pose it sits at
+// offset * local relative to `parent` (another kept node, or the model for
+// -1): `offset` is the baked path of static nodes in between, `local` the
+// node's own transform, which animation channels replace. Parents come
+// before their children.
+struct NodeData {
+    std::string name;
+    int         parent = -1;
+    glm::mat4   offset = glm::mat4(1.0f);
+    glm::mat4   local = glm::mat4(1.0f);
+};
+
+// Keys [first, first + count) of one track in its clip's arrays
+struct KeyRange {
+    uint32_t first = 0;
+    uint32_t count = 0;
+};
+
+struct AnimationChannel {
+    int      node = -1;   // index into the model's NodeData
+    KeyRange position;    // vec3Times / vec3Values
+    KeyRange rotation;    // quatTimes / quatValues
+    KeyRange scale;       // vec3Times / vec3Values
+};
+
+// One animation, every track's keys packed into four flat arrays. Times
+// are in seconds and sorted within a track.
+struct AnimationClip {
+    std::string                   name;
+    float                         duration = 0.0f;
+    std::vector<AnimationChannel> channels;
+    std::vector<float>            vec3Times;
+    std::vector<glm::vec3>        vec3Values;
+    std::vector<float>            quatTimes;
+    std::vector<glm::quat>        quatValues;
+};
+
+// Per-channel playback state: the key each track sampled last
+struct KeyCursor {
+    uint32_t position = 0;
+    uint32_t rotation = 0;
+    uint32_t scale = 0;
+};
+
+// Converts an aiAnimation, keeping channels that target one of `nodes`.
+// A missing track holds the node's bind-pose value.
+inline AnimationClip loadClip(const aiAnimation* anim, const std::vector<NodeData>& nodes) {
+    AnimationClip clip;
+    clip.name = anim->mName.C_Str();
+    const double ticksPerSecond = anim->mTicksPerSecond > 0.0 ? anim->mTicksPerSecond : 25.0;
+    clip.duration = float(anim->mDuration / ticksPerSecond);
+    for (unsigned int c = 0; c < anim->mNumChannels; ++c) {
+        const aiNodeAnim* ch = anim->mChannels[c];
+        auto node = std::find_if(nodes.begin(), nodes.end(),
+            [&](const NodeData& n) { return n.name == ch->mNodeName.C_Str(); });
+        if (node == nodes.end())
+            continue;
+        AnimationChannel out;
+        out.node = int(node - nodes.begin());
+
+        // Bind pose, for tracks without keys
+        const glm::mat4& bind = node->local;
+        const glm::vec3 bindScale(glm::length(glm::vec3(bind[0])), glm::length(glm::vec3(bind[1])),
+                                  glm::length(glm::vec3(bind[2])));
+        const glm::mat3 bindRotation(glm::vec3(bind[0]) / bindScale.x, glm::vec3(bind[1]) / bindScale.y,
+                                     glm::vec3(bind[2]) / bindScale.z);
+
+        auto vec3Track = [&](const aiVectorKey* keys, unsigned int count, const glm::vec3& fallback) {
+            KeyRange r{ uint32_t(clip.vec3Times.size()), std::max(count, 1u) };
+            for (unsigned int k = 0; k < count; ++k) {
+                clip.vec3Times.push_back(float(keys[k].mTime / ticksPerSecond));
+                clip.vec3Values.emplace_back(keys[k].mValue.x, keys[k].mValue.y, keys[k].mValue.z);
+            }
+            if (count == 0) {
+                clip.vec3Times.push_back(0.0f);
+                clip.vec3Values.push_back(fallback);
+            }
+            return r;
+        };
+        out.position = vec3Track(ch->mPositionKeys, ch->mNumPositionKeys, glm::vec3(bind[3]));
+        out.scale = vec3Track(ch->mScalingKeys, ch->mNumScalingKeys, bindScale);
+        out.rotation = { uint32_t(clip.quatTimes.size()), std::max(ch->mNumRotationKeys, 1u) };
+        for (unsigned int k = 0; k < ch->mNumRotationKeys; ++k) {
+            const aiQuaternion& q = ch->mRotationKeys[k].mValue;
+            clip.quatTimes.push_back(float(ch->mRotationKeys[k].mTime / ticksPerSecond));
+            clip.quatValues.emplace_back(q.w, q.x, q.y, q.z);
+        }
+        if (ch->mNumRotationKeys == 0) {
+            clip.quatTimes.push_back(0.0f);
+            clip.quatValues.push_back(glm::quat_cast(bindRotation));
+        }
+        clip.channels.push_back(out);
+    }
+    return clip;
+}
+
+// Last key at or before `t`, searching forward from `cursor`. Playback
+// moves forward, so this is O(1) per frame; going back (a loop wrap)
+// restarts from the first key.
+inline uint32_t advanceCursor(const float* times, const KeyRange& range, float t, uint32_t cursor) {
+    if (cursor >= range.count || times[range.first + cursor] > t)
+        cursor = 0;
+    while (cursor + 1 < range.count && times[range.first + cursor + 1] <= t)
+        ++cursor;
+    return cursor;
+}
+
+inline float keyBlend(const float* times, const KeyRange& range, uint32_t cursor, float t) {
+    if (cursor + 1 >= range.count)
+        return 0.0f;
+    const float t0 = times[range.first + cursor], t1 = times[range.first + cursor + 1];
+    return t1 > t0 ? glm::clamp((t - t0) / (t1 - t0), 0.0f, 1.0f) : 0.0f;
+}
+
+// Node transform of `channel` at `t` seconds (translate * rotate * scale)
+inline glm::mat4 sampleChannel(const AnimationClip& clip, const AnimationChannel& channel, float t,
+                               KeyCursor& cursor) {
+    auto vec3At = [&](const KeyRange& r, uint32_t& c) {
+        c = advanceCursor(clip.vec3Times.data(), r, t, c);
+        const glm::vec3& a = clip.vec3Values[r.first + c];
+        if (c + 1 >= r.count)
+            return a;
+        return glm::mix(a, clip.vec3Values[r.first + c + 1], keyBlend(clip.vec3Times.data(), r, c, t));
+    };
+    const glm::vec3 position = vec3At(channel.position, cursor.position);
+    const glm::vec3 scale = vec3At(channel.scale, cursor.scale);
+
+    const KeyRange& r = channel.rotation;
+    cursor.rotation = advanceCursor(clip.quatTimes.data(), r, t, cursor.rotation);
+    glm::quat rotation = clip.quatValues[r.first + cursor.rotation];
+    if (cursor.rotation + 1 < r.count)
+        rotation = glm::slerp(rotation, clip.quatValues[r.first + cursor.rotation + 1],
+            keyBlend(clip.quatTimes.data(), r, cursor.rotation, t));
+
+    glm::mat4 m = glm::mat4_cast(glm::normalize(rotation));
+    m[0] *= scale.x;
+    m[1] *= scale.y;
+    m[2] *= scale.z;
+    m[3] = glm::vec4(position, 1.0f);
+    return m;
+}
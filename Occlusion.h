@@ -0,0 +1,374 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define OCCLUSION_SSE 1
+#endif
+
+// Software occlusion culling. Occluders (triangle soups, see
+// Model::getOccluder()) are rasterized each frame into a small depth
+// buffer: the screen is split into tiles, and worker threads first
+// transform and near-clip the occluders, then fill one tile each, four
+// pixels per SSE2 step. The buffer holds 1/w (0 where nothing is drawn),
+// which is linear in screen space and keeps its precision far away. Boxes
+// are tested against the farthest depth of every 8x8 block they cover,
+// which is conservative: a box is culled only if occluders nearer than its
+// nearest corner cover all of it.
+namespace Occlusion {
+
+constexpr int kWidth  = 320;
+constexpr int kHeight = 192;
+constexpr int kTileWidth  = 64;
+constexpr int kTileHeight = 32;
+constexpr int kBlock  = 8;                       // test granularity
+constexpr int kTilesX = kWidth / kTileWidth;
+constexpr int kTilesY = kHeight / kTileHeight;
+constexpr int kBlocksX = kWidth / kBlock;
+constexpr int kBlocksY = kHeight / kBlock;
+static_assert(kWidth % kTileWidth == 0 && kHeight % kTileHeight == 0, "tiles must cover the buffer");
+static_assert(kTileWidth % kBlock == 0 && kTileHeight % kBlock == 0, "blocks must not span tiles");
+
+// Fixed set of threads running index ranges; the calling thread joins in
+class WorkerPool {
+public:
+    explicit WorkerPool(unsigned threads) {
+        for (unsigned i = 0; i < threads; ++i)
+            workers.emplace_back([this] { loop(); });
+    }
+
+    ~WorkerPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& w : workers)
+            w.join();
+    }
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    // Calls job(i) for every i in [0, count) and returns when all are done
+    void run(size_t count, const std::function<void(size_t)>& job) {
+        if (count == 0)
+            return;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            current = &job;
+            total = count;
+            next = 0;
+            busy = workers.size();
+            ++generation;
+        }
+        wake.notify_all();
+        work();
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this] { return busy == 0; });
+        current = nullptr;
+    }
+
+private:
+    void work() {
+        for (size_t i = next++; i < total; i = next++)
+            (*current)(i);
+    }
+
+    void loop() {
+        uint64_t seen = 0;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&] { return stopping || generation != seen; });
+                if (stopping)
+                    return;
+                seen = generation;
+            }
+            work();
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--busy == 0)
+                done.notify_one();
+        }
+    }
+
+    std::vector<std::thread>               workers;
+    std::mutex                             mutex;
+    std::condition_variable                wake, done;
+    const std::function<void(size_t)>*     current = nullptr;
+    std::atomic<size_t>                    next{ 0 };
+    size_t                                 total = 0;
+    size_t                                 busy = 0;
+    uint64_t                               generation = 0;
+    bool                                   stopping = false;
+};
+
+class Culler {
+public:
+    struct Stats {
+        size_t occluders = 0;
+        size_t triangles = 0;   // after near clipping
+        size_t tested = 0;
+        size_t culled = 0;
+    };
+
+    // threads: extra workers besides the calling thread
+    explicit Culler(unsigned threads = defaultThreads())
+        : pool(threads), depth(size_t(kWidth) * kHeight), blockFar(size_t(kBlocksX) * kBlocksY) {}
+
+    static unsigned defaultThreads() {
+        const unsigned n = std::thread::hardware_concurrency();
+        return std::min(3u, n > 1 ? n - 1 : 0u);
+    }
+
+    void begin(const glm::mat4& viewProj) {
+        this->viewProj = viewProj;
+        occluders.clear();
+        stats = Stats();
+        ready = false;
+    }
+
+    // `triangles` (three points each, model space) must stay alive until
+    // rasterize() returns
+    void addOccluder(const std::vector<glm::vec3>& triangles, const glm::mat4& model) {
+        if (triangles.size() >= 3)
+            occluders.push_back({ &triangles, viewProj * model, 0, 0 });
+    }
+
+    size_t occluderTriangles() const {
+        size_t n = 0;
+        for (const Occluder& o : occluders)
+            n += o.triangles->size() / 3;
+        return n;
+    }
+
+    // Transforms and clips every occluder, then fills the depth buffer
+    void rasterize() {
+        size_t first = 0;
+        for (Occluder& o : occluders) {
+            o.first = first;
+            first += o.triangles->size() / 3 * 2;   // near clipping makes at most two
+        }
+        screen.resize(first);
+        pool.run(occluders.size(), [this](size_t i) { transform(occluders[i]); });
+        pool.run(size_t(kTilesX) * kTilesY, [this](size_t t) { fillTile(int(t % kTilesX), int(t / kTilesX)); });
+        stats.occluders = occluders.size();
+        for (const Occluder& o : occluders)
+            stats.triangles += o.count;
+        ready = true;
+    }
+
+    // False if the world-space box is certainly hidden behind the occluders
+    bool visible(const glm::vec3& lo, const glm::vec3& hi) {
+        if (!ready)
+            return true;
+        ++stats.tested;
+        float x0 = 1e30f, y0 = 1e30f, x1 = -1e30f, y1 = -1e30f, nearest = 0.0f;
+        for (int c = 0; c < 8; ++c) {
+            const glm::vec4 p = viewProj * glm::vec4((c & 1) ? hi.x : lo.x, (c & 2) ? hi.y : lo.y,
+                                                     (c & 4) ? hi.z : lo.z, 1.0f);
+            if (p.w <= kNearW)
+                return true;   // reaches behind the camera
+            const float inv = 1.0f / p.w;
+            const float sx = (p.x * inv * 0.5f + 0.5f) * kWidth;
+            const float sy = (p.y * inv * 0.5f + 0.5f) * kHeight;
+            x0 = std::min(x0, sx);
+            x1 = std::max(x1, sx);
+            y0 = std::min(y0, sy);
+            y1 = std::max(y1, sy);
+            nearest = std::max(nearest, inv);
+        }
+        // Hidden only if clearly behind: the box's own triangles may be
+        // among the occluders, and rounding must not let them hide it
+        const float limit = nearest * (1.0f + kDepthBias);
+        const int bx0 = std::max(0, int(x0) / kBlock), bx1 = std::min(kBlocksX - 1, int(x1) / kBlock);
+        const int by0 = std::max(0, int(y0) / kBlock), by1 = std::min(kBlocksY - 1, int(y1) / kBlock);
+        if (x1 < 0.0f || y1 < 0.0f || bx0 > bx1 || by0 > by1)
+            return true;   // off screen: frustum culling's business
+        for (int by = by0; by <= by1; ++by)
+            for (int bx = bx0; bx <= bx1; ++bx)
+                if (blockFar[size_t(by) * kBlocksX + bx] <= limit)
+                    return true;
+        ++stats.culled;
+        return false;
+    }
+
+    const Stats& getStats() const { return stats; }
+    // 1/w per pixel, row 0 at the bottom; 0 where nothing was drawn
+    const std::vector<float>& getDepth() const { return depth; }
+
+private:
+    static constexpr float kNearW = 1e-3f;
+    static constexpr float kDepthBias = 1e-3f;   // relative
+
+    struct Occluder {
+        const std::vector<glm::vec3>* triangles;
+        glm::mat4                     mvp;
+        size_t                        first;   // into `screen`
+        size_t                        count;
+    };
+
+    // Screen-space triangle, pixels and 1/w, with its pixel bounds
+    struct ScreenTri {
+        float x[3], y[3], z[3];
+        int   minX, maxX, minY, maxY;
+    };
+
+    void transform(Occluder& o) {
+        const std::vector<glm::vec3>& tris = *o.triangles;
+        ScreenTri* out = screen.data() + o.first;
+        size_t n = 0;
+        for (size_t t = 0; t + 2 < tris.size(); t += 3) {
+            glm::vec4 in[3] = { o.mvp * glm::vec4(tris[t], 1.0f), o.mvp * glm::vec4(tris[t + 1], 1.0f),
+                                o.mvp * glm::vec4(tris[t + 2], 1.0f) };
+            // Clip against w = kNearW; a triangle becomes zero, one or two
+            glm::vec4 poly[4];
+            int count = 0;
+            for (int i = 0; i < 3; ++i) {
+                const glm::vec4& a = in[i];
+                const glm::vec4& b = in[(i + 1) % 3];
+                const bool aIn = a.w > kNearW, bIn = b.w > kNearW;
+                if (aIn)
+                    poly[count++] = a;
+                if (aIn != bIn)
+                    poly[count++] = glm::mix(a, b, (kNearW - a.w) / (b.w - a.w));
+            }
+            for (int k = 1; k + 1 < count; ++k)
+                if (project(poly[0], poly[k], poly[k + 1], out[n]))
+                    ++n;
+        }
+        o.count = n;
+    }
+
+    static bool project(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c, ScreenTri& t) {
+        const glm::vec4* v[3] = { &a, &b, &c };
+        for (int i = 0; i < 3; ++i) {
+            const float inv = 1.0f / v[i]->w;
+            t.x[i] = (v[i]->x * inv * 0.5f + 0.5f) * kWidth;
+            t.y[i] = (v[i]->y * inv * 0.5f + 0.5f) * kHeight;
+            t.z[i] = inv;
+        }
+        t.minX = std::max(0, int(std::floor(std::min({ t.x[0], t.x[1], t.x[2] }))));
+        t.maxX = std::min(kWidth - 1, int(std::ceil(std::max({ t.x[0], t.x[1], t.x[2] }))));
+        t.minY = std::max(0, int(std::floor(std::min({ t.y[0], t.y[1], t.y[2] }))));
+        t.maxY = std::min(kHeight - 1, int(std::ceil(std::max({ t.y[0], t.y[1], t.y[2] }))));
+        return t.minX <= t.maxX && t.minY <= t.maxY;
+    }
+
+    void fillTile(int tx, int ty) {
+        const int x0 = tx * kTileWidth, y0 = ty * kTileHeight;
+        const int x1 = x0 + kTileWidth - 1, y1 = y0 + kTileHeight - 1;
+        for (int y = y0; y <= y1; ++y)
+            std::fill_n(depth.begin() + size_t(y) * kWidth + x0, kTileWidth, 0.0f);
+        for (const Occluder& o : occluders)
+            for (size_t i = 0; i < o.count; ++i) {
+                const ScreenTri& t = screen[o.first + i];
+                if (t.maxX < x0 || t.minX > x1 || t.maxY < y0 || t.minY > y1)
+                    continue;
+                fillTriangle(t, std::max(t.minX, x0), std::min(t.maxX, x1),
+                    std::max(t.minY, y0), std::min(t.maxY, y1));
+            }
+        // Farthest depth per block, for visible()
+        for (int by = y0 / kBlock; by <= y1 / kBlock; ++by)
+            for (int bx = x0 / kBlock; bx <= x1 / kBlock; ++bx) {
+                float m = 1e30f;
+                for (int y = by * kBlock; y < (by + 1) * kBlock; ++y) {
+                    const float* row = depth.data() + size_t(y) * kWidth + bx * kBlock;
+                    m = std::min(m, *std::min_element(row, row + kBlock));
+                }
+                blockFar[size_t(by) * kBlocksX + bx] = m;
+            }
+    }
+
+    // Edge functions and depth are planes in screen space: value at pixel
+    // center (px, py) = a * px + b * py + c
+    void fillTriangle(const ScreenTri& t, int minX, int maxX, int minY, int maxY) {
+        float area = (t.x[1] - t.x[0]) * (t.y[2] - t.y[0]) - (t.y[1] - t.y[0]) * (t.x[2] - t.x[0]);
+        if (std::abs(area) < 1e-8f)
+            return;
+        const float s = area > 0.0f ? 1.0f : -1.0f;   // either winding
+        area *= s;
+        float ea[3], eb[3], ec[3];
+        for (int i = 0; i < 3; ++i) {
+            // Edge opposite vertex i, from j to k. A shared edge is set up
+            // from the same endpoint in both triangles, so the two see
+            // exactly negated values and no pixel on it falls through.
+            int j = (i + 1) % 3, k = (i + 2) % 3;
+            float e = s;
+            if (t.x[j] > t.x[k] || (t.x[j] == t.x[k] && t.y[j] > t.y[k])) {
+                std::swap(j, k);
+                e = -e;
+            }
+            const float dx = t.x[k] - t.x[j], dy = t.y[k] - t.y[j];
+            ea[i] = -dy * e;
+            eb[i] = dx * e;
+            ec[i] = (dy * t.x[j] - dx * t.y[j]) * e;
+        }
+        const float inv = 1.0f / area;
+        const float za = (ea[0] * t.z[0] + ea[1] * t.z[1] + ea[2] * t.z[2]) * inv;
+        const float zb = (eb[0] * t.z[0] + eb[1] * t.z[1] + eb[2] * t.z[2]) * inv;
+        const float zc = (ec[0] * t.z[0] + ec[1] * t.z[1] + ec[2] * t.z[2]) * inv;
+
+#ifdef OCCLUSION_SSE
+        // Four pixels per step from a 4-aligned column; tiles are 4-aligned
+        // too, so the extra columns stay inside the tile
+        const int startX = minX & ~3;
+        const __m128 offsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+        const __m128 zero = _mm_setzero_ps();
+        for (int y = minY; y <= maxY; ++y) {
+            const float py = y + 0.5f;
+            float* row = depth.data() + size_t(y) * kWidth;
+            for (int x = startX; x <= maxX; x += 4) {
+                // Evaluated afresh rather than stepped, to stay watertight
+                const __m128 px = _mm_add_ps(_mm_set1_ps(float(x)), offsets);
+                __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+                for (int i = 0; i < 3; ++i) {
+                    const __m128 e = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(ea[i]), px),
+                                                _mm_set1_ps(eb[i] * py + ec[i]));
+                    inside = _mm_and_ps(inside, _mm_cmpge_ps(e, zero));
+                }
+                if (_mm_movemask_ps(inside) == 0)
+                    continue;
+                const __m128 z = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(za), px), _mm_set1_ps(zb * py + zc));
+                const __m128 old = _mm_loadu_ps(row + x);
+                const __m128 nearer = _mm_max_ps(old, z);
+                _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearer), _mm_andnot_ps(inside, old)));
+            }
+        }
+#else
+        for (int y = minY; y <= maxY; ++y) {
+            const float py = y + 0.5f;
+            float* row = depth.data() + size_t(y) * kWidth;
+            for (int x = minX; x <= maxX; ++x) {
+                const float px = x + 0.5f;
+                if (ea[0] * px + eb[0] * py + ec[0] < 0.0f || ea[1] * px + eb[1] * py + ec[1] < 0.0f ||
+                    ea[2] * px + eb[2] * py + ec[2] < 0.0f)
+                    continue;
+                row[x] = std::max(row[x], za * px + zb * py + zc);
+            }
+        }
+#endif
+    }
+
+    WorkerPool             pool;
+    glm::mat4              viewProj{ 1.0f };
+    std::vector<Occluder>  occluders;
+    std::vector<ScreenTri> screen;
+    std::vector<float>     depth;      // kWidth x kHeight
+    std::vector<float>     blockFar;   // kBlocksX x kBlocksY, smallest 1/w
+    Stats                  stats;
+    bool                   ready = false;
+};
+
+} // namespace Occlusion
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "ModelCache.h"
+#include "TileStreamer.h"
+
+// Loads what a later part of a scripted scenario needs before it starts.
+// Each set lists the models and world areas of one part (e.g. one branch of
+// the chase). Every frame the caller says how many seconds remain until each
+// set is needed, or that it is no longer reachable:
+//   - within the horizon, the set's models are requested at a priority below
+//     anything the current view needs, sooner-needed sets first, and its
+//     areas are handed to the TileStreamer as prefetch points;
+//   - unreachable, the set's handles are dropped, which cancels its queued
+//     loads and frees what was already uploaded (unless the scene still
+//     holds it).
+// Context thread only.
+class PrefetchScheduler {
+public:
+    static constexpr float kUnreachable = -1.0f;
+    // Visible loads use their distance as priority; prefetches rank after
+    static constexpr float kBasePriority = 1.0e4f;
+
+    struct Set {
+        std::vector<std::string> models;
+        std::vector<glm::vec3>   areas;
+    };
+
+    PrefetchScheduler(ModelCache& models, ImportProfile profile, float horizonSeconds = 15.0f,
+                      float unitsPerSecond = 30.0f)
+        : models(models), profile(profile), horizon(horizonSeconds), unitsPerSecond(unitsPerSecond) {}
+
+    int addSet(const Set& set) {
+        sets.push_back({ set, std::vector<ModelHandle>(set.models.size()), kUnreachable });
+        return static_cast<int>(sets.size()) - 1;
+    }
+
+    // secondsUntilNeeded: 0 if needed now, kUnreachable if it never will be
+    void update(int set, float secondsUntilNeeded) {
+        Entry& e = sets[size_t(set)];
+        e.seconds = secondsUntilNeeded;
+        if (secondsUntilNeeded < 0.0f) {
+            for (auto& h : e.handles)
+                h.reset();
+            return;
+        }
+        if (secondsUntilNeeded > horizon)
+            return;
+        const float priority = secondsUntilNeeded > 0.0f ? kBasePriority + secondsUntilNeeded : 0.0f;
+        for (size_t i = 0; i < e.handles.size(); ++i) {
+            if (!e.handles[i])
+                e.handles[i] = models.loadAsync(e.set.models[i], profile, false, priority);
+            else
+                models.prioritize(e.handles[i], priority);
+        }
+    }
+
+    // Null until the set has been requested (and again once it is dropped)
+    const ModelHandle& model(int set, size_t index) const {
+        return sets[size_t(set)].handles[index];
+    }
+
+    // True once every model of the set is uploaded (or failed)
+    bool resident(int set) const {
+        for (const auto& h : sets[size_t(set)].handles)
+            if (!h || (!h->isReady() && !h->hasFailed()))
+                return false;
+        return true;
+    }
+
+    // Areas of every set due within the horizon, leads scaled by how far off
+    // they are
+    std::vector<TileStreamer::Prefetch> tilePrefetch() const {
+        std::vector<TileStreamer::Prefetch> out;
+        for (const auto& e : sets)
+            if (e.seconds >= 0.0f && e.seconds <= horizon)
+                for (const auto& p : e.set.areas)
+                    out.push_back({ p, e.seconds * unitsPerSecond });
+        return out;
+    }
+
+    void clear() {
+        for (auto& e : sets)
+            for (auto& h : e.handles)
+                h.reset();
+    }
+
+private:
+    struct Entry {
+        Set                      set;
+        std::vector<ModelHandle> handles;
+        float                    seconds;
+    };
+
+    ModelCache&        models;
+    ImportProfile      profile;
+    float              horizon;
+    float              unitsPerSecond;
+    std::vector<Entry> sets;
+};
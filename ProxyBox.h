@@ -0,0 +1,70 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "Model.h"
+
+// Unit cube in the Vertex layout, drawn scaled to a model's bounds as a
+// stand-in while that model is still loading. Owns its VAO/VBO; create and
+// destroy it on the context thread.
+class ProxyBox {
+public:
+    ProxyBox() {
+        // 6 faces x 2 triangles, flat normals so the box is lit like a mesh
+        static const float faces[6][2][3] = {
+            { { 1, 0, 0 }, { 0, 1, 0 } }, { { -1, 0, 0 }, { 0, 0, 1 } },
+            { { 0, 1, 0 }, { 0, 0, 1 } }, { { 0, -1, 0 }, { 1, 0, 0 } },
+            { { 0, 0, 1 }, { 1, 0, 0 } }, { { 0, 0, -1 }, { 0, 1, 0 } },
+        };
+        Vertex verts[36];
+        int n = 0;
+        for (const auto& f : faces) {
+            glm::vec3 normal(f[0][0], f[0][1], f[0][2]);
+            glm::vec3 u(f[1][0], f[1][1], f[1][2]);
+            glm::vec3 v = glm::cross(normal, u);
+            // Face centre on the unit cube [0,1]^3, corners at +-u/2 +-v/2
+            glm::vec3 c = glm::vec3(0.5f) + normal * 0.5f;
+            glm::vec3 corners[4] = {
+                c - u * 0.5f - v * 0.5f, c + u * 0.5f - v * 0.5f,
+                c + u * 0.5f + v * 0.5f, c - u * 0.5f + v * 0.5f };
+            for (int idx : { 0, 1, 2, 0, 2, 3 })
+                verts[n++] = { corners[idx], normal };
+        }
+        glGenVertexArrays(1, &VAO);
+        glBindVertexArray(VAO);
+        VBO = createStaticBuffer(GL_ARRAY_BUFFER, sizeof(verts), verts);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+            reinterpret_cast<void*>(offsetof(Vertex, Position)));
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+            reinterpret_cast<void*>(offsetof(Vertex, Normal)));
+        glBindVertexArray(0);
+    }
+
+    ~ProxyBox() {
+        glDeleteVertexArrays(1, &VAO);
+        GpuMemory::deleteBuffer(VBO);
+    }
+
+    ProxyBox(const ProxyBox&) = delete;
+    ProxyBox& operator=(const ProxyBox&) = delete;
+
+    // Draws the box spanning the model's bounds; nothing if they are unknown
+    void Draw(GLint modelLoc, const glm::mat4& objectMatrix, const Model& model) const {
+        if (!model.hasBounds())
+            return;
+        glm::mat4 m = glm::translate(objectMatrix, model.getBoundsMin());
+        m = glm::scale(m, model.getBoundsMax() - model.getBoundsMin());
+        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(m));
+        glBindVertexArray(VAO);
+        glDrawArrays(GL_TRIANGLES, 0, 36);
+        glBindVertexArray(0);
+    }
+
+private:
+    GLuint VAO = 0, VBO = 0;
+};
@@ -0,0 +1,335 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+
+#include "AssetPack.h"
+#include "CompiledAsset.h"
+#include "MappedFile.h"
+#include "MeshCache.h"
+
+// Scene description: a line-based text file for editing, compiled to a flat
+// binary that is mapped as-is at startup (no parsing, no per-object
+// allocation). Text syntax, one statement per line, '#' starts a comment:
+//
+//   model    <name> <path> [group <group>]
+//   world    <path> [placement]
+//   object   <model> [placement]
+//   actor    <name> <model> [placement]
+//   waypoint <name> <x> <y> <z>
+//   area     <group> <x> <y> <z>
+//
+//   placement: [position x y z] [rotation x y z] [scale s | scale x y z]
+//              [color r g b]        (defaults 0, 0, 1, 1)
+//
+// Models with a group are loaded on demand (see PrefetchScheduler); areas
+// name the world regions a group needs. Actors are objects the application
+// drives by name. Binary layout, each table 16-byte aligned:
+//
+//   Header | ModelRecord[] | WorldRecord[] | ObjectRecord[] | PointRecord
+//   waypoints[] | PointRecord areas[] | strings (NUL-terminated)
+namespace SceneFile {
+
+constexpr uint32_t kMagic   = 0x53574D4D; // "MMWS"
+constexpr uint32_t kVersion = 1;
+constexpr uint32_t kNone    = 0xFFFFFFFF;
+
+enum Table { Models, Worlds, Objects, Waypoints, Areas, Strings, TableCount };
+
+struct Header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t count[TableCount];    // records (bytes for Strings)
+    uint32_t offset[TableCount];
+};
+
+// Every uint32_t name/path/group below is an offset into the strings table
+struct ModelRecord {
+    uint32_t name;
+    uint32_t path;
+    uint32_t group;                // kNone: loaded with the scene
+};
+
+struct Placement {
+    float position[3];
+    float rotation[3];             // Euler degrees
+    float scale[3];
+    float color[3];
+};
+
+struct WorldRecord {
+    uint32_t  path;
+    Placement placement;
+};
+
+struct ObjectRecord {
+    uint32_t  model;               // index into the model table
+    uint32_t  name;                // kNone for static objects, else an actor
+    Placement placement;
+};
+
+struct PointRecord {
+    uint32_t name;                 // waypoint name or area group
+    float    position[3];
+};
+
+inline std::string binaryPathFor(const std::string& source,
+                                 const std::string& outDir = CompiledAsset::kOutputDir) {
+    return (std::filesystem::path(outDir) / (CompiledAsset::relativeSource(source) + ".bin")).string();
+}
+
+// Parses the text form into the binary form. On failure `error` names the
+// offending line.
+inline bool compile(const std::string& text, const std::string& sourceName,
+                    std::vector<unsigned char>& out, std::string& error) {
+    std::vector<ModelRecord> models;
+    std::vector<WorldRecord> worlds;
+    std::vector<ObjectRecord> objects;
+    std::vector<PointRecord> waypoints, areas;
+    std::string strings;
+    std::unordered_map<std::string, uint32_t> interned, modelIndex;
+    auto intern = [&](const std::string& s) {
+        auto it = interned.find(s);
+        if (it != interned.end())
+            return it->second;
+        const uint32_t offset = static_cast<uint32_t>(strings.size());
+        strings += s;
+        strings += '\0';
+        interned.emplace(s, offset);
+        return offset;
+    };
+
+    std::istringstream lines(text);
+    std::string line;
+    for (int lineNo = 1; std::getline(lines, line); ++lineNo) {
+        const size_t hash = line.find('#');
+        if (hash != std::string::npos)
+            line.resize(hash);
+        std::istringstream in(line);
+        std::string keyword;
+        if (!(in >> keyword))
+            continue;
+        auto fail = [&](const std::string& what) {
+            error = sourceName + ":" + std::to_string(lineNo) + ": " + what;
+            return false;
+        };
+        auto readVec3 = [&](float* v) { return bool(in >> v[0] >> v[1] >> v[2]); };
+        auto readPlacement = [&](Placement& p) {
+            p = Placement{ { 0, 0, 0 }, { 0, 0, 0 }, { 1, 1, 1 }, { 1, 1, 1 } };
+            std::string attr;
+            while (in >> attr) {
+                if (attr == "position" && readVec3(p.position)) continue;
+                if (attr == "rotation" && readVec3(p.rotation)) continue;
+                if (attr == "color" && readVec3(p.color)) continue;
+                if (attr == "scale" && in >> p.scale[0]) {
+                    // One value scales uniformly, three per axis; two is an error
+                    p.scale[1] = p.scale[2] = p.scale[0];
+                    const std::streampos mark = in.tellg();
+                    if (in >> p.scale[1]) {
+                        if (!(in >> p.scale[2]))
+                            return false;
+                    }
+                    else {
+                        p.scale[1] = p.scale[0];
+                        in.clear();
+                        in.seekg(mark);
+                    }
+                    continue;
+                }
+                return false;
+            }
+            return true;
+        };
+        auto findModel = [&](const std::string& name, uint32_t& index) {
+            auto it = modelIndex.find(name);
+            if (it == modelIndex.end())
+                return false;
+            index = it->second;
+            return true;
+        };
+
+        if (keyword == "model") {
+            std::string name, path, attr, group;
+            if (!(in >> name >> path))
+                return fail("expected: model <name> <path> [group <group>]");
+            if (in >> attr && (attr != "group" || !(in >> group)))
+                return fail("expected: group <group>");
+            if (!modelIndex.emplace(name, static_cast<uint32_t>(models.size())).second)
+                return fail("model '" + name + "' defined twice");
+            models.push_back({ intern(name), intern(path), group.empty() ? kNone : intern(group) });
+        }
+        else if (keyword == "world") {
+            std::string path;
+            WorldRecord w{};
+            if (!(in >> path) || !readPlacement(w.placement))
+                return fail("expected: world <path> [placement]");
+            w.path = intern(path);
+            worlds.push_back(w);
+        }
+        else if (keyword == "object" || keyword == "actor") {
+            std::string name, model;
+            if (keyword == "actor" && !(in >> name))
+                return fail("expected: actor <name> <model> [placement]");
+            ObjectRecord o{};
+            if (!(in >> model))
+                return fail("expected a model name");
+            if (!findModel(model, o.model))
+                return fail("unknown model '" + model + "'");
+            if (!readPlacement(o.placement))
+                return fail("bad placement");
+            o.name = name.empty() ? kNone : intern(name);
+            objects.push_back(o);
+        }
+        else if (keyword == "waypoint" || keyword == "area") {
+            std::string name;
+            PointRecord p{};
+            if (!(in >> name) || !readVec3(p.position))
+                return fail("expected: " + keyword + " <name> <x> <y> <z>");
+            p.name = intern(name);
+            (keyword == "waypoint" ? waypoints : areas).push_back(p);
+        }
+        else {
+            return fail("unknown statement '" + keyword + "'");
+        }
+    }
+
+    Header hdr{};
+    hdr.magic = kMagic;
+    hdr.version = kVersion;
+    const void* tables[TableCount] = { models.data(), worlds.data(), objects.data(),
+                                       waypoints.data(), areas.data(), strings.data() };
+    const size_t sizes[TableCount] = {
+        models.size() * sizeof(ModelRecord), worlds.size() * sizeof(WorldRecord),
+        objects.size() * sizeof(ObjectRecord), waypoints.size() * sizeof(PointRecord),
+        areas.size() * sizeof(PointRecord), strings.size() };
+    const size_t counts[TableCount] = { models.size(), worlds.size(), objects.size(),
+                                        waypoints.size(), areas.size(), strings.size() };
+    size_t offset = MeshCache::align16(sizeof(Header));
+    for (int t = 0; t < TableCount; ++t) {
+        hdr.count[t] = static_cast<uint32_t>(counts[t]);
+        hdr.offset[t] = static_cast<uint32_t>(offset);
+        offset = MeshCache::align16(offset + sizes[t]);
+    }
+    out.assign(offset, 0);
+    std::memcpy(out.data(), &hdr, sizeof(hdr));
+    for (int t = 0; t < TableCount; ++t)
+        if (sizes[t])
+            std::memcpy(out.data() + hdr.offset[t], tables[t], sizes[t]);
+    return true;
+}
+
+// Read-only view of a compiled scene; every accessor points into the mapping
+class Scene {
+public:
+    bool open(const std::string& binaryPath) {
+        if (!AssetFiles::open(binaryPath, file) || file.size() < sizeof(Header))
+            return false;
+        std::memcpy(&hdr, file.data(), sizeof(hdr));
+        if (hdr.magic != kMagic || hdr.version != kVersion)
+            return invalid();
+        const size_t recordSize[TableCount] = { sizeof(ModelRecord), sizeof(WorldRecord),
+            sizeof(ObjectRecord), sizeof(PointRecord), sizeof(PointRecord), 1 };
+        for (int t = 0; t < TableCount; ++t)
+            if (hdr.offset[t] % 4 != 0 ||
+                size_t(hdr.offset[t]) + size_t(hdr.count[t]) * recordSize[t] > file.size())
+                return invalid();
+        // Strings must end in NUL so every offset reads as a C string
+        if (hdr.count[Strings] && file.data()[hdr.offset[Strings] + hdr.count[Strings] - 1] != '\0')
+            return invalid();
+        // Objects index the model table directly
+        for (size_t i = 0; i < objectCount(); ++i)
+            if (object(i).model >= modelCount())
+                return invalid();
+        return true;
+    }
+
+    bool valid() const { return file.valid(); }
+
+    size_t modelCount()    const { return hdr.count[Models]; }
+    size_t worldCount()    const { return hdr.count[Worlds]; }
+    size_t objectCount()   const { return hdr.count[Objects]; }
+    size_t waypointCount() const { return hdr.count[Waypoints]; }
+    size_t areaCount()     const { return hdr.count[Areas]; }
+
+    const ModelRecord&  model(size_t i)    const { return table<ModelRecord>(Models)[i]; }
+    const WorldRecord&  world(size_t i)    const { return table<WorldRecord>(Worlds)[i]; }
+    const ObjectRecord& object(size_t i)   const { return table<ObjectRecord>(Objects)[i]; }
+    const PointRecord&  waypoint(size_t i) const { return table<PointRecord>(Waypoints)[i]; }
+    const PointRecord&  area(size_t i)     const { return table<PointRecord>(Areas)[i]; }
+
+    // "" for kNone or an out-of-range offset
+    const char* str(uint32_t offset) const {
+        if (offset >= hdr.count[Strings])
+            return "";
+        return reinterpret_cast<const char*>(file.data() + hdr.offset[Strings] + offset);
+    }
+
+    // Copies the named waypoint into `out`; false (and `out` untouched) if
+    // the scene does not have it
+    bool findWaypoint(const char* name, float* out) const {
+        for (size_t i = 0; i < waypointCount(); ++i)
+            if (std::strcmp(str(waypoint(i).name), name) == 0) {
+                std::memcpy(out, waypoint(i).position, sizeof(float) * 3);
+                return true;
+            }
+        return false;
+    }
+
+private:
+    template <typename T>
+    const T* table(Table t) const {
+        return reinterpret_cast<const T*>(file.data() + hdr.offset[t]);
+    }
+
+    bool invalid() {
+        file.close();
+        hdr = Header{};
+        return false;
+    }
+
+    MappedFile file;
+    Header     hdr{};
+};
+
+// Writes the binary for `source` if it is missing or older than the text
+inline bool compileIfStale(const std::string& source, std::string& error) {
+    const std::string binary = binaryPathFor(source);
+    std::error_code ec;
+    const auto sourceTime = std::filesystem::last_write_time(source, ec);
+    if (ec)
+        return true;   // no loose text (e.g. shipped in a pack): use the binary as is
+    const auto binaryTime = std::filesystem::last_write_time(binary, ec);
+    if (!ec && binaryTime >= sourceTime)
+        return true;
+    std::ifstream in(source, std::ios::binary);
+    std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    std::vector<unsigned char> out;
+    if (!compile(text, source, out, error))
+        return false;
+    if (!CompiledAsset::writeAtomically(binary, out)) {
+        error = "could not write " + binary;
+        return false;
+    }
+    return true;
+}
+
+// Compiles the text if needed, then maps the binary
+inline bool load(const std::string& source, Scene& scene, std::string& error) {
+    if (!compileIfStale(source, error))
+        return false;
+    if (!scene.open(binaryPathFor(source))) {
+        error = "could not open " + binaryPathFor(source);
+        return false;
+    }
+    return true;
+}
+
+} // namespace SceneFile
@@ -0,0 +1,231 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "ModelCache.h"
+#include "WorldTiles.h"
+
+// Keeps the tiles of one static world (see WorldTiles.h) resident around a
+// focus point. Tiles closer than loadRadius are requested through the
+// ModelCache, so they load on the loader's workers like any other model;
+// resident tiles are only dropped past unloadRadius (hysteresis) or when the
+// nearest tiles need their share of budgetBytes. Memory therefore stays flat
+// however large the world is.
+//
+// If the world has no tile index yet, it is built once on a background
+// thread; until then nothing is resident. Everything else is context-thread
+// only, like ModelCache.
+class TileStreamer {
+public:
+    struct Settings {
+        float  loadRadius   = 150.0f;        // world units
+        float  unloadRadius = 200.0f;
+        size_t budgetBytes  = 256u << 20;    // vertex + index bytes
+        int    tilesPerAxis = 16;            // used when the index is built
+    };
+
+    // An area that will be needed later. `lead` (world units) is added to
+    // its tiles' distance, so they rank behind tiles needed now.
+    struct Prefetch {
+        glm::vec3 point;
+        float     lead;
+    };
+
+    TileStreamer(ModelCache& models, const std::string& source, ImportProfile profile)
+        : TileStreamer(models, source, profile, Settings()) {}
+
+    TileStreamer(ModelCache& models, const std::string& source, ImportProfile profile,
+                 const Settings& settings)
+        : models(models), source(source), settings(settings),
+          // Tiles load through the compiled-asset path, which physics skips
+          profile(profile == ImportProfile::Physics ? ImportProfile::RenderOptimized : profile) {
+        if (!openIndex())
+            startBuild();
+    }
+
+    ~TileStreamer() {
+        if (builder.joinable())
+            builder.join();
+    }
+
+    TileStreamer(const TileStreamer&) = delete;
+    TileStreamer& operator=(const TileStreamer&) = delete;
+
+    // Context thread, once per frame: `focus` in world space, `objectMatrix`
+    // places the world model (same as SceneObject::getModelMatrix()).
+    // Tiles near any `prefetch` point are wanted too, at a lower rank.
+    void update(const glm::vec3& focus, const glm::mat4& objectMatrix,
+                const std::vector<Prefetch>& prefetch = {}) {
+        if (builder.joinable() && buildDone) {
+            builder.join();
+            if (!buildOk || !openIndex())
+                std::cerr << "ERROR::TILESTREAMER::" << source << ": " << buildError << std::endl;
+        }
+        if (tiles.empty())
+            return;
+        if (objectMatrix != placedWith)
+            place(objectMatrix);
+
+        struct Candidate { size_t tile; float key; float dist; };
+        std::vector<Candidate> candidates;
+        const float hysteresis = settings.unloadRadius - settings.loadRadius;
+        for (size_t i = 0; i < tiles.size(); ++i) {
+            const Tile& t = tiles[i];
+            const bool loaded = t.model != nullptr;
+            const float radius = loaded ? settings.unloadRadius : settings.loadRadius;
+            // Rank by the nearest focus, prefetch points pushed back by their lead
+            const float d = glm::distance(glm::clamp(focus, t.lo, t.hi), focus);
+            float rank = d <= radius ? d : FLT_MAX;
+            for (const Prefetch& p : prefetch) {
+                const float pd = glm::distance(glm::clamp(p.point, t.lo, t.hi), p.point);
+                if (pd <= radius)
+                    rank = std::min(rank, pd + p.lead);
+            }
+            if (rank != FLT_MAX)
+                candidates.push_back({ i, loaded ? rank - hysteresis : rank, rank });
+        }
+        std::sort(candidates.begin(), candidates.end(),
+            [](const Candidate& a, const Candidate& b) { return a.key < b.key; });
+
+        std::vector<float> keep(tiles.size(), -1.0f);
+        size_t bytes = 0;
+        for (const Candidate& c : candidates) {
+            const size_t need = size_t(tiles[c.tile].rec.gpuBytes);
+            if (bytes + need > settings.budgetBytes)
+                continue;
+            bytes += need;
+            keep[c.tile] = c.dist;
+        }
+
+        for (size_t i = 0; i < tiles.size(); ++i) {
+            Tile& t = tiles[i];
+            if (keep[i] < 0.0f) {
+                if (t.model)
+                    ++changes;
+                t.model.reset();   // frees the buffers once the last handle goes
+            }
+            else if (!t.model) {
+                ++changes;
+                t.model = models.loadAsync(
+                    WorldTiles::tileSource(source, t.rec.x, t.rec.z), profile, false, keep[i]);
+                if (!t.model->hasBounds()) {
+                    MeshCache::Bounds b;
+                    std::memcpy(b.min, t.rec.boundsMin, sizeof(b.min));
+                    std::memcpy(b.max, t.rec.boundsMax, sizeof(b.max));
+                    t.model->setBounds(b);
+                }
+            }
+            else {
+                models.prioritize(t.model, keep[i]);
+            }
+        }
+        resident = bytes;
+    }
+
+    // Calls f(const ModelHandle&) for every requested tile, loaded or not
+    template <typename F>
+    void forEachResident(F&& f) const {
+        for (const Tile& t : tiles)
+            if (t.model)
+                f(t.model);
+    }
+
+    // Calls f(size_t index, const glm::vec3& lo, const glm::vec3& hi,
+    // const ModelHandle& model) for every tile of the index: the box is in
+    // world space, `model` is null unless the tile is requested
+    template <typename F>
+    void forEachTile(F&& f) const {
+        for (size_t i = 0; i < tiles.size(); ++i)
+            f(i, tiles[i].lo, tiles[i].hi, tiles[i].model);
+    }
+    const ModelHandle& tileModel(size_t i) const { return tiles[i].model; }
+
+    // Drops every tile; call on the context thread before it goes away
+    void clear() {
+        for (Tile& t : tiles)
+            t.model.reset();
+        resident = 0;
+        ++changes;
+    }
+
+    // Changes whenever a tile is requested or dropped, or the tiles move
+    uint64_t version() const { return changes; }
+
+    bool   building()      const { return builder.joinable(); }
+    size_t tileCount()     const { return tiles.size(); }
+    size_t residentBytes() const { return resident; }
+    size_t residentCount() const {
+        return size_t(std::count_if(tiles.begin(), tiles.end(),
+            [](const Tile& t) { return t.model != nullptr; }));
+    }
+
+private:
+    struct Tile {
+        WorldTiles::TileRecord rec;
+        glm::vec3              lo{ 0.0f }, hi{ 0.0f };   // world-space box
+        ModelHandle            model;
+    };
+
+    bool openIndex() {
+        WorldTiles::Index index;
+        if (!WorldTiles::loadIndex(source, profile, index))
+            return false;
+        tiles.clear();
+        for (const auto& rec : index.tiles)
+            tiles.push_back({ rec, glm::vec3(0.0f), glm::vec3(0.0f), nullptr });
+        placedWith = glm::mat4(0.0f);
+        ++changes;
+        return true;
+    }
+
+    void startBuild() {
+        std::cout << "Building world tiles for " << source << std::endl;
+        builder = std::thread([this] {
+            Assimp::Importer importer;
+            std::vector<std::string> outputs;
+            buildOk = WorldTiles::build(source, profile, settings.tilesPerAxis, importer, outputs, buildError);
+            buildDone = true;
+        });
+    }
+
+    void place(const glm::mat4& m) {
+        for (Tile& t : tiles) {
+            t.lo = glm::vec3(1e30f);
+            t.hi = glm::vec3(-1e30f);
+            for (int c = 0; c < 8; ++c) {
+                glm::vec3 corner((c & 1) ? t.rec.boundsMax[0] : t.rec.boundsMin[0],
+                                 (c & 2) ? t.rec.boundsMax[1] : t.rec.boundsMin[1],
+                                 (c & 4) ? t.rec.boundsMax[2] : t.rec.boundsMin[2]);
+                glm::vec3 w = glm::vec3(m * glm::vec4(corner, 1.0f));
+                t.lo = glm::min(t.lo, w);
+                t.hi = glm::max(t.hi, w);
+            }
+        }
+        placedWith = m;
+        ++changes;
+    }
+
+    ModelCache&       models;
+    std::string       source;
+    Settings          settings;
+    ImportProfile     profile;
+    std::vector<Tile> tiles;
+    glm::mat4         placedWith{ 0.0f };
+    size_t            resident = 0;
+    uint64_t          changes = 0;
+
+    std::thread       builder;
+    std::atomic<bool> buildDone{ false };
+    bool              buildOk = false;
+    std::string       buildError;
+};
@@ -0,0 +1,245 @@
+#pragma once
+
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+
+#include <glad/glad.h>
+
+#include "GpuMemory.h"
+
+// glad is generated for GL 4.3 core; buffer storage (GL 4.4 /
+// ARB_buffer_storage) is loaded by hand when the driver has it.
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#define GL_MAP_COHERENT_BIT   0x0080
+#endif
+typedef void (APIENTRYP PFNBUFFERSTORAGEPROC)(GLenum target, GLsizeiptr size,
+                                              const void* data, GLbitfield flags);
+inline PFNBUFFERSTORAGEPROC gBufferStorage = nullptr;
+
+// Static GPU buffer: immutable storage when available, glBufferData otherwise.
+// `data` may be null to allocate only (filled later by a copy). The buffer
+// is recorded in GpuMemory; free it with GpuMemory::deleteBuffer().
+inline GLuint createStaticBuffer(GLenum target, size_t size, const void* data) {
+    GLuint buffer = 0;
+    glGenBuffers(1, &buffer);
+    glBindBuffer(target, buffer);
+    if (gBufferStorage && size != 0)
+        gBufferStorage(target, static_cast<GLsizeiptr>(size), data, 0);
+    else
+        glBufferData(target, static_cast<GLsizeiptr>(size), data, GL_STATIC_DRAW);
+    GpuMemory::track(GpuMemory::Kind::Buffer, buffer, size);
+    return buffer;
+}
+
+// A completion fence shared by every copy submitted together
+class UploadFence {
+public:
+    explicit UploadFence(GLsync sync) : sync(sync) {}
+    ~UploadFence() { if (sync) glDeleteSync(sync); }
+    UploadFence(const UploadFence&) = delete;
+    UploadFence& operator=(const UploadFence&) = delete;
+
+    // GL thread. With wait, blocks until the GPU has executed the copies.
+    bool poll(bool wait = false) {
+        if (signaled)
+            return true;
+        GLuint64 timeout = wait ? GLuint64(1000000000) : 0;
+        GLenum r = glClientWaitSync(sync, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, timeout);
+        signaled = (r == GL_ALREADY_SIGNALED || r == GL_CONDITION_SATISFIED);
+        return signaled;
+    }
+
+private:
+    GLsync sync;
+    bool   signaled = false;
+};
+using UploadFenceRef = std::shared_ptr<UploadFence>;
+
+// Bytes reserved in the staging ring; `ptr` is writable from any thread
+struct StagingRegion {
+    size_t         offset = 0;
+    size_t         size = 0;
+    unsigned char* ptr = nullptr;
+    explicit operator bool() const { return ptr != nullptr; }
+};
+
+// Upload service built on a persistently mapped, coherent staging buffer.
+// Loader threads reserve() space and memcpy geometry into it; the GL thread
+// copy()s regions into their destination buffers with glCopyBufferSubData
+// and submit()s a fence. Space is recycled in reservation order once the
+// fence covering it has signalled (update()).
+class UploadRing {
+public:
+    static constexpr size_t kAlignment = 256;
+
+    UploadRing() = default;
+    ~UploadRing() { shutdown(); }
+    UploadRing(const UploadRing&) = delete;
+    UploadRing& operator=(const UploadRing&) = delete;
+
+    // GL thread. Returns false (and stays disabled) without buffer storage;
+    // callers then upload with glBufferData as before.
+    bool init(GLADloadproc getProc, size_t bytes = size_t(64) << 20) {
+        GLint major = 0, minor = 0;
+        glGetIntegerv(GL_MAJOR_VERSION, &major);
+        glGetIntegerv(GL_MINOR_VERSION, &minor);
+        bool supported = major > 4 || (major == 4 && minor >= 4);
+        if (!supported) {
+            GLint count = 0;
+            glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+            for (GLint i = 0; i < count && !supported; ++i) {
+                const char* ext = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+                supported = ext && std::strcmp(ext, "GL_ARB_buffer_storage") == 0;
+            }
+        }
+        if (supported)
+            gBufferStorage = reinterpret_cast<PFNBUFFERSTORAGEPROC>(getProc("glBufferStorage"));
+        if (!gBufferStorage)
+            return false;
+
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+        gBufferStorage(GL_COPY_READ_BUFFER, static_cast<GLsizeiptr>(bytes), nullptr, flags);
+        mapped = static_cast<unsigned char*>(
+            glMapBufferRange(GL_COPY_READ_BUFFER, 0, static_cast<GLsizeiptr>(bytes), flags));
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        if (!mapped) {
+            glDeleteBuffers(1, &buffer);
+            buffer = 0;
+            return false;
+        }
+        GpuMemory::track(GpuMemory::Kind::Staging, buffer, bytes);
+        capacity = bytes;
+        return true;
+    }
+
+    // GL thread
+    void shutdown() {
+        if (!buffer)
+            return;
+        glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+        glUnmapBuffer(GL_COPY_READ_BUFFER);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        GpuMemory::deleteBuffer(buffer, GpuMemory::Kind::Staging);
+        std::lock_guard<std::mutex> lock(mutex);
+        regions.clear();
+        mapped = nullptr;
+        capacity = 0;
+    }
+
+    bool enabled() const { return mapped != nullptr; }
+
+    // Any thread. Returns an empty region if the ring is disabled or has no
+    // room right now; the caller then keeps the data for a direct upload.
+    StagingRegion reserve(size_t size) {
+        StagingRegion out;
+        if (!mapped || size == 0)
+            return out;
+        size = (size + kAlignment - 1) & ~(kAlignment - 1);
+        std::lock_guard<std::mutex> lock(mutex);
+        size_t at;
+        if (regions.empty()) {
+            head = 0;
+            if (size > capacity)
+                return out;
+            at = 0;
+        }
+        else {
+            const size_t tail = regions.front().offset;
+            const bool wrapped = regions.back().offset < tail;
+            if (!wrapped && head + size <= capacity)
+                at = head;
+            else if (!wrapped && size <= tail)
+                at = 0;
+            else if (wrapped && head + size <= tail)
+                at = head;
+            else
+                return out;
+        }
+        regions.push_back({ at, size, nullptr, false });
+        head = at + size;
+        out.offset = at;
+        out.size = size;
+        out.ptr = mapped + at;
+        return out;
+    }
+
+    // GL thread: returns a region without copying it (e.g. its model was
+    // dropped before upload)
+    void cancel(const StagingRegion& region) {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto& r : regions)
+            if (r.offset == region.offset && !r.done)
+                r.done = true;
+    }
+
+    // GL thread: copies `size` bytes at `srcOffset` inside the region into
+    // `dst` (bound to GL_COPY_WRITE_BUFFER). Covered by the next submit().
+    void copy(const StagingRegion& region, size_t srcOffset, size_t size,
+              GLuint dst, size_t dstOffset) {
+        glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, dst);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+            static_cast<GLintptr>(region.offset + srcOffset),
+            static_cast<GLintptr>(dstOffset), static_cast<GLsizeiptr>(size));
+        std::lock_guard<std::mutex> lock(mutex);
+        for (size_t i = 0; i < regions.size(); ++i)
+            if (regions[i].offset == region.offset && !regions[i].done)
+                pendingCopies.push_back(i);
+    }
+
+    // GL thread: fences every copy issued since the last submit and returns
+    // the fence, or null if nothing was copied
+    UploadFenceRef submit() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (pendingCopies.empty())
+            return nullptr;
+        auto fence = std::make_shared<UploadFence>(glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+        for (size_t index : pendingCopies) {
+            regions[index].fence = fence;
+            regions[index].done = true;
+        }
+        pendingCopies.clear();
+        glFlush();
+        return fence;
+    }
+
+    // GL thread, once per frame: recycles space whose copies have completed
+    void update() {
+        std::lock_guard<std::mutex> lock(mutex);
+        while (!regions.empty() && pendingCopies.empty()) {
+            Region& r = regions.front();
+            if (!r.done || (r.fence && !r.fence->poll()))
+                break;
+            regions.pop_front();
+        }
+    }
+
+    size_t bytesInFlight() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        size_t total = 0;
+        for (const auto& r : regions)
+            total += r.size;
+        return total;
+    }
+
+private:
+    struct Region {
+        size_t         offset;
+        size_t         size;
+        UploadFenceRef fence;  // set by submit()
+        bool           done;   // copied and fenced, or cancelled
+    };
+
+    GLuint             buffer = 0;
+    unsigned char*     mapped = nullptr;
+    size_t             capacity = 0;
+    size_t             head = 0;
+    mutable std::mutex mutex;
+    std::deque<Region> regions;
+    std::deque<size_t> pendingCopies;  // indices into regions, cleared by submit()
+};
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <assimp/mesh.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define VERTEX_CONVERT_SSE 1
+#endif
+
+// Bulk conversion of aiMesh arrays into the interleaved Position/Normal
+// layout used by Vertex (6 floats per vertex) and into flat uint32 indices.
+namespace VertexConvert {
+
+// out[6*i .. 6*i+5] = pos[i].xyz, nrm[i].xyz (zero normal when nrm is null)
+inline void interleaveScalar(const aiVector3D* pos, const aiVector3D* nrm,
+                             size_t count, float* out) {
+    for (size_t i = 0; i < count; ++i, out += 6) {
+        out[0] = pos[i].x;
+        out[1] = pos[i].y;
+        out[2] = pos[i].z;
+        out[3] = nrm ? nrm[i].x : 0.0f;
+        out[4] = nrm ? nrm[i].y : 0.0f;
+        out[5] = nrm ? nrm[i].z : 0.0f;
+    }
+}
+
+#ifdef VERTEX_CONVERT_SSE
+// Four vertices per iteration: three xyz-packed registers of positions and
+// three of normals are shuffled into six registers of interleaved output.
+inline void interleaveSSE(const aiVector3D* pos, const aiVector3D* nrm,
+                          size_t count, float* out) {
+    static_assert(sizeof(aiVector3D) == 3 * sizeof(float), "aiVector3D must be packed floats");
+    const float* p = reinterpret_cast<const float*>(pos);
+    const float* n = reinterpret_cast<const float*>(nrm);
+    const __m128 zero = _mm_setzero_ps();
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4, p += 12, out += 24) {
+        __m128 p0 = _mm_loadu_ps(p);     // x0 y0 z0 x1
+        __m128 p1 = _mm_loadu_ps(p + 4); // y1 z1 x2 y2
+        __m128 p2 = _mm_loadu_ps(p + 8); // z2 x3 y3 z3
+        __m128 n0 = zero, n1 = zero, n2 = zero;
+        if (n) {
+            n0 = _mm_loadu_ps(n);
+            n1 = _mm_loadu_ps(n + 4);
+            n2 = _mm_loadu_ps(n + 8);
+            n += 12;
+        }
+        __m128 t0 = _mm_shuffle_ps(p0, n0, _MM_SHUFFLE(0, 0, 2, 2));
+        __m128 t1 = _mm_shuffle_ps(p0, p1, _MM_SHUFFLE(0, 0, 3, 3));
+        __m128 t2 = _mm_shuffle_ps(p1, n0, _MM_SHUFFLE(3, 3, 1, 1));
+        __m128 t3 = _mm_shuffle_ps(p2, n1, _MM_SHUFFLE(2, 2, 0, 0));
+        __m128 t4 = _mm_shuffle_ps(n1, n2, _MM_SHUFFLE(0, 0, 3, 3));
+        __m128 t5 = _mm_shuffle_ps(p2, n2, _MM_SHUFFLE(1, 1, 3, 3));
+        _mm_storeu_ps(out,      _mm_shuffle_ps(p0, t0, _MM_SHUFFLE(2, 0, 1, 0))); // x0 y0 z0 nx0
+        _mm_storeu_ps(out + 4,  _mm_shuffle_ps(n0, t1, _MM_SHUFFLE(2, 0, 2, 1))); // ny0 nz0 x1 y1
+        _mm_storeu_ps(out + 8,  _mm_shuffle_ps(t2, n1, _MM_SHUFFLE(1, 0, 2, 0))); // z1 nx1 ny1 nz1
+        _mm_storeu_ps(out + 12, _mm_shuffle_ps(p1, t3, _MM_SHUFFLE(2, 0, 3, 2))); // x2 y2 z2 nx2
+        _mm_storeu_ps(out + 16, _mm_shuffle_ps(t4, p2, _MM_SHUFFLE(2, 1, 2, 0))); // ny2 nz2 x3 y3
+        _mm_storeu_ps(out + 20, _mm_shuffle_ps(t5, n2, _MM_SHUFFLE(3, 2, 2, 0))); // z3 nx3 ny3 nz3
+    }
+    interleaveScalar(pos + i, nrm ? nrm + i : nullptr, count - i, out);
+}
+#endif
+
+inline void interleave(const aiVector3D* pos, const aiVector3D* nrm,
+                       size_t count, float* out) {
+#ifdef VERTEX_CONVERT_SSE
+    interleaveSSE(pos, nrm, count, out);
+#else
+    interleaveScalar(pos, nrm, count, out);
+#endif
+}
+
+// Copies triangle faces as straight index triples into out (room for
+// 3 * faceCount indices). Stops at the first face that is not a triangle
+// and returns how many faces were copied, so the caller can fall back.
+inline size_t copyTriangles(const aiFace* faces, size_t faceCount, uint32_t* out) {
+    size_t i = 0;
+    for (; i < faceCount; ++i, out += 3) {
+        const aiFace& f = faces[i];
+        if (f.mNumIndices != 3)
+            break;
+        out[0] = f.mIndices[0];
+        out[1] = f.mIndices[1];
+        out[2] = f.mIndices[2];
+    }
+    return i;
+}
+
+} // namespace VertexConvert
@@ -0,0 +1,242 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+
+#include "AssetPack.h"
+#include "CompiledAsset.h"
+#include "MeshCache.h"
+#include "Model.h"
+
+// Static world split into a grid of XZ tiles, each an ordinary compiled mesh
+// (see CompiledAsset.h) that ModelCache can load under a virtual source path
+// "<source>#<x>_<z>". An index next to them lists every tile with its
+// model-space bounds and GPU size so TileStreamer can plan residency without
+// touching the tiles themselves.
+//
+//   compiled/<source>.<profile>.tiles          IndexHeader | TileRecord[tileCount]
+//   compiled/<source>#<x>_<z>.<profile>.mesh   one per non-empty tile
+//
+// Triangles go to the tile holding their centroid, so tiles may overlap a
+// little at their edges but never share a triangle.
+namespace WorldTiles {
+
+constexpr uint32_t kIndexMagic = 0x49574D4D; // "MMWI"
+constexpr uint32_t kVersion    = 2;
+
+struct IndexHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t tilesPerAxis;
+    uint32_t tileCount;
+    uint32_t toolVersion;   // CompiledAsset::kToolVersion of the tiles
+    uint32_t reserved;
+    uint64_t sourceSize;
+    int64_t  sourceTime;
+    float    boundsMin[3];
+    float    boundsMax[3];
+};
+
+struct TileRecord {
+    int32_t  x, z;
+    uint32_t meshCount;
+    uint32_t reserved;
+    float    boundsMin[3];
+    float    boundsMax[3];
+    uint64_t gpuBytes;   // vertex + index buffer bytes once uploaded
+};
+
+struct Index {
+    uint32_t                tilesPerAxis = 0;
+    MeshCache::Bounds       bounds;
+    std::vector<TileRecord> tiles;
+};
+
+inline std::string tileSource(const std::string& source, int x, int z) {
+    return CompiledAsset::relativeSource(source) + '#' + std::to_string(x) + '_' + std::to_string(z);
+}
+
+inline std::string indexPathFor(const std::string& source, ImportProfile profile,
+                                const std::string& outDir = CompiledAsset::kOutputDir) {
+    return (std::filesystem::path(outDir) /
+        (CompiledAsset::relativeSource(source) + '.' + profileName(profile) + ".tiles")).string();
+}
+
+// Reads the index through AssetFiles. An index whose recorded source stamp
+// no longer matches the loose source, or whose tiles an older assetc or
+// streamer wrote, is stale; a source that only exists in a pack is trusted.
+// Tiles carry no version of their own, so the index vouches for them.
+inline bool loadIndex(const std::string& source, ImportProfile profile, Index& index) {
+    MappedFile file;
+    IndexHeader hdr;
+    if (!AssetFiles::open(indexPathFor(source, profile), file) || file.size() < sizeof(hdr))
+        return false;
+    std::memcpy(&hdr, file.data(), sizeof(hdr));
+    if (hdr.magic != kIndexMagic || hdr.version != kVersion || hdr.toolVersion != CompiledAsset::kToolVersion ||
+        sizeof(hdr) + size_t(hdr.tileCount) * sizeof(TileRecord) > file.size())
+        return false;
+    uint64_t size = 0;
+    int64_t time = 0;
+    if (MeshCache::sourceStamp(source, size, time) && (size != hdr.sourceSize || time != hdr.sourceTime))
+        return false;
+    index.tilesPerAxis = hdr.tilesPerAxis;
+    std::memcpy(index.bounds.min, hdr.boundsMin, sizeof(index.bounds.min));
+    std::memcpy(index.bounds.max, hdr.boundsMax, sizeof(index.bounds.max));
+    index.tiles.resize(hdr.tileCount);
+    std::memcpy(index.tiles.data(), file.data() + sizeof(hdr), index.tiles.size() * sizeof(TileRecord));
+    return true;
+}
+
+// Buckets every triangle of `meshes` into a tilesPerAxis^2 grid over the XZ
+// extent of `bounds`, keyed by (x, z). Vertices are copied into each tile
+// that uses them.
+inline std::map<std::pair<int, int>, std::vector<MeshData>> split(
+        const std::vector<MeshData>& meshes, const MeshCache::Bounds& bounds, int tilesPerAxis) {
+    std::map<std::pair<int, int>, std::vector<MeshData>> tiles;
+    const float sizeX = std::max(bounds.max[0] - bounds.min[0], 1e-6f) / tilesPerAxis;
+    const float sizeZ = std::max(bounds.max[2] - bounds.min[2], 1e-6f) / tilesPerAxis;
+    auto cell = [tilesPerAxis](float v, float lo, float size) {
+        int c = static_cast<int>(std::floor((v - lo) / size));
+        return c < 0 ? 0 : (c >= tilesPerAxis ? tilesPerAxis - 1 : c);
+    };
+
+    // Per mesh: bucket triangles by tile, then copy each bucket out with one
+    // remap table that a generation stamp resets between tiles
+    std::vector<uint32_t> remap, stamp;
+    std::vector<size_t> start;
+    std::vector<uint32_t> order, tileOf;
+    uint32_t generation = 0;
+    const size_t tileCount = size_t(tilesPerAxis) * tilesPerAxis;
+    for (const MeshData& mesh : meshes) {
+        const size_t triCount = mesh.indices.size() / 3;
+        tileOf.resize(triCount);
+        start.assign(tileCount + 1, 0);
+        for (size_t t = 0; t < triCount; ++t) {
+            const glm::vec3 centroid = (mesh.vertices[mesh.indices[3 * t]].Position +
+                                        mesh.vertices[mesh.indices[3 * t + 1]].Position +
+                                        mesh.vertices[mesh.indices[3 * t + 2]].Position) / 3.0f;
+            tileOf[t] = static_cast<uint32_t>(cell(centroid.z, bounds.min[2], sizeZ) * tilesPerAxis +
+                                              cell(centroid.x, bounds.min[0], sizeX));
+            ++start[tileOf[t] + 1];
+        }
+        for (size_t i = 0; i < tileCount; ++i)
+            start[i + 1] += start[i];
+        order.resize(triCount);
+        std::vector<size_t> fill(start.begin(), start.end() - 1);
+        for (size_t t = 0; t < triCount; ++t)
+            order[fill[tileOf[t]]++] = static_cast<uint32_t>(t);
+
+        remap.resize(mesh.vertices.size());
+        stamp.assign(mesh.vertices.size(), 0);
+        for (size_t tile = 0; tile < tileCount; ++tile) {
+            if (start[tile] == start[tile + 1])
+                continue;
+            ++generation;
+            MeshData out;
+            for (size_t i = start[tile]; i < start[tile + 1]; ++i) {
+                for (size_t k = 0; k < 3; ++k) {
+                    const uint32_t v = mesh.indices[3 * size_t(order[i]) + k];
+                    if (stamp[v] != generation) {
+                        stamp[v] = generation;
+                        remap[v] = static_cast<uint32_t>(out.vertices.size());
+                        out.vertices.push_back(mesh.vertices[v]);
+                    }
+                    out.indices.push_back(remap[v]);
+                }
+            }
+            const std::pair<int, int> key(int(tile % tilesPerAxis), int(tile / tilesPerAxis));
+            tiles[key].push_back(std::move(out));
+        }
+    }
+    return tiles;
+}
+
+// Imports `source` with `profile`, writes one compiled mesh per non-empty
+// tile plus the index. `outputs` receives every file written.
+inline bool build(const std::string& source, ImportProfile profile, int tilesPerAxis,
+                  Assimp::Importer& importer, std::vector<std::string>& outputs, std::string& error) {
+    if (!dynamic_cast<MmapIOSystem*>(importer.GetIOHandler()))
+        importer.SetIOHandler(new MmapIOSystem);
+    configureImporter(importer, profile);
+    const aiScene* scene = importer.ReadFile(source, importFlagsFor(profile));
+    if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
+        error = importer.GetErrorString();
+        return false;
+    }
+    std::vector<MeshData> meshes;
+    processNode(scene->mRootNode, scene, meshes);
+    importer.FreeScene();
+
+    std::vector<MeshCache::MeshBlob> blobs;
+    for (const auto& m : meshes)
+        blobs.push_back({ m.vertices.data(), m.vertices.size(), m.indices.data(), m.indices.size() });
+    const MeshCache::Bounds bounds = MeshCache::computeBounds(blobs, sizeof(Vertex));
+    if (bounds.empty()) {
+        error = "no triangle meshes";
+        return false;
+    }
+
+    const auto tiles = split(meshes, bounds, tilesPerAxis);
+    meshes.clear();
+    std::vector<TileRecord> records;
+    for (const auto& tile : tiles) {
+        blobs.clear();
+        for (const auto& m : tile.second)
+            blobs.push_back({ m.vertices.data(), m.vertices.size(), m.indices.data(), m.indices.size() });
+        const MeshCache::Bounds tileBounds = MeshCache::computeBounds(blobs, sizeof(Vertex));
+
+        TileRecord rec{};
+        rec.x = tile.first.first;
+        rec.z = tile.first.second;
+        rec.meshCount = static_cast<uint32_t>(blobs.size());
+        std::memcpy(rec.boundsMin, tileBounds.min, sizeof(rec.boundsMin));
+        std::memcpy(rec.boundsMax, tileBounds.max, sizeof(rec.boundsMax));
+        std::vector<std::vector<CompiledAsset::QuantizedVertex>> quantized(blobs.size());
+        for (size_t i = 0; i < blobs.size(); ++i) {
+            for (const Vertex& v : tile.second[i].vertices)
+                quantized[i].push_back(CompiledAsset::quantize(&v.Position.x, &v.Normal.x, tileBounds));
+            blobs[i].vertices = quantized[i].data();
+            rec.gpuBytes += blobs[i].vertexCount * sizeof(CompiledAsset::QuantizedVertex) +
+                            blobs[i].indexCount * sizeof(uint32_t);
+        }
+        const std::string path = CompiledAsset::meshPathFor(tileSource(source, rec.x, rec.z), profileName(profile));
+        if (!CompiledAsset::writeMesh(path, blobs, tileBounds)) {
+            error = "could not write " + path;
+            return false;
+        }
+        outputs.push_back(path);
+        records.push_back(rec);
+    }
+
+    IndexHeader hdr{};
+    hdr.magic = kIndexMagic;
+    hdr.version = kVersion;
+    hdr.tilesPerAxis = static_cast<uint32_t>(tilesPerAxis);
+    hdr.tileCount = static_cast<uint32_t>(records.size());
+    hdr.toolVersion = CompiledAsset::kToolVersion;
+    MeshCache::sourceStamp(source, hdr.sourceSize, hdr.sourceTime);
+    std::memcpy(hdr.boundsMin, bounds.min, sizeof(hdr.boundsMin));
+    std::memcpy(hdr.boundsMax, bounds.max, sizeof(hdr.boundsMax));
+    std::vector<unsigned char> out(sizeof(hdr) + records.size() * sizeof(TileRecord));
+    std::memcpy(out.data(), &hdr, sizeof(hdr));
+    std::memcpy(out.data() + sizeof(hdr), records.data(), records.size() * sizeof(TileRecord));
+    const std::string indexPath = indexPathFor(source, profile);
+    if (!CompiledAsset::writeAtomically(indexPath, out)) {
+        error = "could not write " + indexPath;
+        return false;
+    }
+    outputs.push_back(indexPath);
+    return true;
+}
+
+} // namespace WorldTiles
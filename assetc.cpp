@@ -0,0 +1,516 @@
+// assetc: offline asset compiler.
+//
+// Walks the source roots (default: assets/ and models/) and converts every
+// model into the runtime formats of CompiledAsset.h:
+//   models   -> welded, cache-ordered meshes with quantized vertices
+//   scenes   -> the flat binary of SceneFile.h
+//
+// <out>/assetc.db records, per output, a cheap stamp (size + mtime of the
+// source and its dependencies) and a content hash. An input is rebuilt only
+// if its stamp changed *and* its content hash did too, or its output is
+// missing. Outputs of deleted sources are removed. Work runs on all cores.
+//
+// --pack also writes <out>/assets.pack (see AssetPack.h): every file under
+// the roots plus every output, LzBlock-compressed where that pays off
+// (--no-compress stores everything). The pack is rewritten only when one of
+// its inputs changed.
+//
+// --world SOURCE splits a large static model into streaming tiles (see
+// WorldTiles.h) for every profile; the tiles go into the pack too.
+//
+// Usage: assetc [--out DIR] [--jobs N] [--profile NAME]... [--force]
+//               [--world SOURCE]... [--pack [--no-compress]] [roots...]
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+#include "AssetPack.h"
+#include "CompiledAsset.h"
+#include "Json.h"
+#include "MappedFile.h"
+#include "Model.h"
+#include "SceneFile.h"
+#include "WorldTiles.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+using CompiledAsset::kToolVersion;
+
+enum class Kind { Model, Scene };
+
+struct Job {
+    Kind                     kind;
+    std::string              source;
+    ImportProfile            profile = ImportProfile::RenderOptimized;
+    std::string              key;      // database key: source (+ profile)
+    std::string              output;
+    std::vector<std::string> deps;     // other files the output depends on
+};
+
+struct DbEntry {
+    uint64_t    stamp = 0;
+    uint64_t    hash = 0;
+    std::string output;
+};
+
+enum class Outcome { UpToDate, Built, Skipped, Failed };
+
+struct Result {
+    Outcome     outcome = Outcome::Failed;
+    DbEntry     entry;
+    std::string error;
+};
+
+std::string lowerExtension(const fs::path& p) {
+    std::string ext = p.extension().string();
+    for (auto& c : ext)
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    return ext;
+}
+
+// External buffers of a .gltf; the rest of the formats are self-contained
+// as far as geometry goes (materials are stripped on import)
+std::vector<std::string> modelDependencies(const std::string& source) {
+    std::vector<std::string> deps;
+    if (!Gltf::isGltfPath(source))
+        return deps;
+    MappedFile text(source);
+    JsonValue doc;
+    std::string error;
+    if (!text.valid() ||
+        !JsonParser::parse(reinterpret_cast<const char*>(text.data()), text.size(), doc, error))
+        return deps;
+    if (const JsonValue* buffers = doc.find("buffers"))
+        for (const auto& b : buffers->array) {
+            std::string uri = b.getString("uri");
+            if (!uri.empty() && uri.compare(0, 5, "data:") != 0)
+                deps.push_back((fs::path(source).parent_path() / uri).lexically_normal().generic_string());
+        }
+    return deps;
+}
+
+uint64_t settingsHash(const Job& job) {
+    uint64_t h = MeshCache::hashBytes(&kToolVersion, sizeof(kToolVersion));
+    h = MeshCache::hashBytes(&CompiledAsset::kVersion, sizeof(CompiledAsset::kVersion), h);
+    if (job.kind == Kind::Model) {
+        unsigned flags = importFlagsFor(job.profile);
+        h = MeshCache::hashBytes(&flags, sizeof(flags), h);
+    }
+    if (job.kind == Kind::Scene)
+        h = MeshCache::hashBytes(&SceneFile::kVersion, sizeof(SceneFile::kVersion), h);
+    return h;
+}
+
+// Size + mtime of the source and its dependencies; no file contents read
+uint64_t stampOf(const Job& job) {
+    uint64_t h = settingsHash(job);
+    auto add = [&h](const std::string& file) {
+        uint64_t size = 0;
+        int64_t time = 0;
+        MeshCache::sourceStamp(file, size, time);
+        h = MeshCache::hashBytes(&size, sizeof(size), h);
+        h = MeshCache::hashBytes(&time, sizeof(time), h);
+    };
+    add(job.source);
+    for (const auto& d : job.deps)
+        add(d);
+    return h;
+}
+
+uint64_t contentHashOf(const Job& job) {
+    uint64_t h = settingsHash(job);
+    auto add = [&h](const std::string& file) {
+        MappedFile f(file);
+        if (f.valid())
+            h = MeshCache::hashBytes(f.data(), f.size(), h);
+        h = MeshCache::hashBytes(file.data(), file.size(), h);
+    };
+    add(job.source);
+    for (const auto& d : job.deps)
+        add(d);
+    return h;
+}
+
+// Animated models are not compiled (`skipped`): the output holds baked
+// model-space meshes only, and the runtime would prefer it over the import
+// that keeps the animated nodes
+bool compileModel(const Job& job, Assimp::Importer& importer, std::string& error, bool& skipped) {
+    configureImporter(importer, job.profile);
+    const aiScene* scene = importer.ReadFile(job.source, importFlagsFor(job.profile));
+    if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
+        error = importer.GetErrorString();
+        return false;
+    }
+    if (scene->mNumAnimations > 0 && !profileKeepsCpuGeometry(job.profile)) {
+        importer.FreeScene();
+        std::error_code ec;
+        fs::remove(job.output, ec);   // an older, static build of it
+        skipped = true;
+        return true;
+    }
+    std::vector<MeshData> meshes;
+    processNode(scene->mRootNode, scene, meshes);
+    importer.FreeScene();
+    if (meshes.empty()) {
+        error = "no triangle meshes";
+        return false;
+    }
+
+    std::vector<MeshCache::MeshBlob> blobs;
+    for (const auto& m : meshes)
+        blobs.push_back({ m.vertices.data(), m.vertices.size(), m.indices.data(), m.indices.size() });
+    const MeshCache::Bounds bounds = MeshCache::computeBounds(blobs, sizeof(Vertex));
+
+    std::vector<std::vector<CompiledAsset::QuantizedVertex>> quantized(meshes.size());
+    for (size_t i = 0; i < meshes.size(); ++i) {
+        quantized[i].reserve(meshes[i].vertices.size());
+        for (const Vertex& v : meshes[i].vertices)
+            quantized[i].push_back(CompiledAsset::quantize(&v.Position.x, &v.Normal.x, bounds));
+        blobs[i].vertices = quantized[i].data();
+    }
+    if (!CompiledAsset::writeMesh(job.output, blobs, bounds)) {
+        error = "could not write " + job.output;
+        return false;
+    }
+    return true;
+}
+
+bool compileScene(const Job& job, std::string& error) {
+    MappedFile text(job.source);
+    if (!text.valid()) {
+        error = "could not read " + job.source;
+        return false;
+    }
+    std::vector<unsigned char> out;
+    if (!SceneFile::compile(std::string(reinterpret_cast<const char*>(text.data()), text.size()),
+                            job.source, out, error))
+        return false;
+    if (!CompiledAsset::writeAtomically(job.output, out)) {
+        error = "could not write " + job.output;
+        return false;
+    }
+    return true;
+}
+
+std::map<std::string, DbEntry> loadDatabase(const std::string& path) {
+    std::map<std::string, DbEntry> db;
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#')
+            continue;
+        std::istringstream fields(line);
+        std::string key, stamp, hash, output;
+        if (std::getline(fields, key, '\t') && std::getline(fields, stamp, '\t') &&
+            std::getline(fields, hash, '\t') && std::getline(fields, output))
+            db[key] = { std::stoull(stamp, nullptr, 16), std::stoull(hash, nullptr, 16), output };
+    }
+    return db;
+}
+
+bool saveDatabase(const std::string& path, const std::map<std::string, DbEntry>& db) {
+    std::ostringstream out;
+    out << "# assetc " << kToolVersion << ": key\tstamp\thash\toutput\n";
+    char buf[40];
+    for (const auto& e : db) {
+        std::snprintf(buf, sizeof(buf), "\t%016llx\t%016llx\t",
+            static_cast<unsigned long long>(e.second.stamp),
+            static_cast<unsigned long long>(e.second.hash));
+        out << e.first << buf << e.second.output << '\n';
+    }
+    const std::string text = out.str();
+    return CompiledAsset::writeAtomically(path, std::vector<unsigned char>(text.begin(), text.end()));
+}
+
+// True if the pack is missing or older than any of `files`
+bool packIsStale(const std::string& packPath, const std::vector<std::string>& files) {
+    std::error_code ec;
+    const auto packTime = fs::last_write_time(packPath, ec);
+    if (ec)
+        return true;
+    for (const auto& f : files) {
+        const auto t = fs::last_write_time(f, ec);
+        if (ec || t > packTime)
+            return true;
+    }
+    return false;
+}
+
+// Reads and encodes `files` on `threadCount` threads, then writes the pack
+bool writePack(const std::string& packPath, const std::vector<std::string>& files,
+               bool compress, unsigned threadCount) {
+    std::vector<AssetPack::Input> inputs(files.size());
+    std::atomic<size_t> next{ 0 };
+    std::atomic<bool> ok{ true };
+    auto worker = [&] {
+        for (size_t i = next++; i < files.size(); i = next++) {
+            MappedFile file(files[i]);
+            if (!file.valid()) {
+                std::error_code ec;
+                if (fs::file_size(files[i], ec) != 0 || ec) {
+                    std::cerr << "ERROR::ASSETC::could not read " << files[i] << std::endl;
+                    ok = false;
+                }
+                inputs[i] = AssetPack::encode(AssetPack::keyFor(files[i]), nullptr, 0, false);
+                continue;
+            }
+            inputs[i] = AssetPack::encode(AssetPack::keyFor(files[i]), file.data(), file.size(), compress);
+        }
+    };
+    std::vector<std::thread> threads;
+    threadCount = static_cast<unsigned>(std::min<size_t>(threadCount, std::max<size_t>(1, files.size())));
+    for (unsigned t = 0; t < threadCount; ++t)
+        threads.emplace_back(worker);
+    for (auto& t : threads)
+        t.join();
+    if (!ok || !AssetPack::write(packPath, inputs))
+        return false;
+
+    uint64_t raw = 0, stored = 0;
+    for (const auto& in : inputs) {
+        raw += in.size;
+        stored += in.data.size();
+    }
+    std::cout << "  " << packPath << ": " << inputs.size() << " entries, "
+        << raw / 1024 << " KB -> " << stored / 1024 << " KB" << std::endl;
+    return true;
+}
+
+int usage() {
+    std::cerr << "usage: assetc [--out DIR] [--jobs N] [--profile NAME]... [--force]\n"
+                 "              [--world SOURCE]... [--pack [--no-compress]] [roots...]\n"
+                 "  defaults: --out " << CompiledAsset::kOutputDir
+              << " --profile render-optimized, roots assets models" << std::endl;
+    return 2;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    using Clock = std::chrono::steady_clock;
+    const auto start = Clock::now();
+
+    std::string outDir = CompiledAsset::kOutputDir;
+    unsigned threadCount = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<ImportProfile> profiles;
+    std::vector<std::string> roots, worlds;
+    bool force = false, pack = false, compress = true;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--out" && i + 1 < argc) {
+            outDir = argv[++i];
+        }
+        else if ((arg == "--jobs" || arg == "-j") && i + 1 < argc) {
+            threadCount = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (arg == "--profile" && i + 1 < argc) {
+            ImportProfile p;
+            if (!parseProfile(argv[++i], p)) {
+                std::cerr << "Unknown import profile: " << argv[i] << std::endl;
+                return 2;
+            }
+            profiles.push_back(p);
+        }
+        else if (arg == "--force") {
+            force = true;
+        }
+        else if (arg == "--world" && i + 1 < argc) {
+            worlds.push_back(argv[++i]);
+        }
+        else if (arg == "--pack") {
+            pack = true;
+        }
+        else if (arg == "--no-compress") {
+            compress = false;
+        }
+        else if (!arg.empty() && arg[0] == '-') {
+            return usage();
+        }
+        else {
+            roots.push_back(arg);
+        }
+    }
+    if (profiles.empty())
+        profiles.push_back(ImportProfile::RenderOptimized);
+    if (roots.empty())
+        roots = { "assets", "models" };
+
+    // Collect inputs
+    std::vector<Job> jobs;
+    std::vector<std::string> packFiles;
+    Assimp::Importer probe;
+    for (const auto& root : roots) {
+        std::error_code ec;
+        if (!fs::is_directory(root, ec)) {
+            std::cerr << "WARNING::ASSETC::skipping missing root " << root << std::endl;
+            continue;
+        }
+        for (fs::recursive_directory_iterator it(root, fs::directory_options::skip_permission_denied, ec), end;
+             it != end; it.increment(ec)) {
+            if (ec || !it->is_regular_file(ec))
+                continue;
+            const std::string source = CompiledAsset::relativeSource(it->path().string());
+            const std::string ext = lowerExtension(it->path());
+            packFiles.push_back(source);
+            if (ext == ".scene") {
+                jobs.push_back({ Kind::Scene, source, ImportProfile::RenderOptimized, source,
+                    SceneFile::binaryPathFor(source, outDir), {} });
+            }
+            else if (!ext.empty() && probe.IsExtensionSupported(ext)) {
+                const std::vector<std::string> deps = modelDependencies(source);
+                for (ImportProfile p : profiles)
+                    jobs.push_back({ Kind::Model, source, p, source + '|' + profileName(p),
+                        CompiledAsset::meshPathFor(source, profileName(p), outDir), deps });
+            }
+        }
+    }
+    std::sort(jobs.begin(), jobs.end(), [](const Job& a, const Job& b) { return a.key < b.key; });
+
+    const std::string dbPath = (fs::path(outDir) / "assetc.db").string();
+    std::map<std::string, DbEntry> db = loadDatabase(dbPath);
+
+    // Convert on all cores; each worker has its own importer
+    std::vector<Result> results(jobs.size());
+    std::atomic<size_t> next{ 0 };
+    std::mutex logMutex;
+    auto worker = [&] {
+        Assimp::Importer importer;
+        importer.SetIOHandler(new MmapIOSystem);
+        for (size_t i = next++; i < jobs.size(); i = next++) {
+            const Job& job = jobs[i];
+            Result& r = results[i];
+            const auto jobStart = Clock::now();
+            r.entry.output = job.output;
+            r.entry.stamp = stampOf(job);
+
+            std::error_code ec;
+            const bool haveOutput = fs::exists(job.output, ec);
+            auto old = db.find(job.key);
+            const bool known = !force && haveOutput && old != db.end() && old->second.output == job.output;
+            if (known && old->second.stamp == r.entry.stamp) {
+                r.entry.hash = old->second.hash;
+                r.outcome = Outcome::UpToDate;
+                continue;
+            }
+            r.entry.hash = contentHashOf(job);
+            if (known && old->second.hash == r.entry.hash) {
+                r.outcome = Outcome::UpToDate;   // touched, not changed
+                continue;
+            }
+
+            bool ok = false, skipped = false;
+            switch (job.kind) {
+            case Kind::Model:   ok = compileModel(job, importer, r.error, skipped); break;
+            case Kind::Scene:   ok = compileScene(job, r.error); break;
+            }
+            r.outcome = skipped ? Outcome::Skipped : ok ? Outcome::Built : Outcome::Failed;
+            const double ms = std::chrono::duration<double, std::milli>(Clock::now() - jobStart).count();
+            std::lock_guard<std::mutex> lock(logMutex);
+            if (skipped)
+                std::cout << "  " << job.key << ": animated, imported at runtime\n";
+            else if (ok)
+                std::cout << "  " << job.key << " -> " << job.output << " (" << ms << " ms)\n";
+            else
+                std::cerr << "ERROR::ASSETC::" << job.key << ": " << r.error << "\n";
+        }
+    };
+    std::vector<std::thread> threads;
+    threadCount = static_cast<unsigned>(std::min<size_t>(threadCount, std::max<size_t>(1, jobs.size())));
+    for (unsigned t = 0; t < threadCount; ++t)
+        threads.emplace_back(worker);
+    for (auto& t : threads)
+        t.join();
+
+    // New database: every current input that has a valid output. Outputs
+    // whose source disappeared are deleted.
+    std::map<std::string, DbEntry> updated;
+    size_t built = 0, upToDate = 0, skipped = 0, failed = 0, removed = 0;
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        switch (results[i].outcome) {
+        case Outcome::Built:    ++built;    break;
+        case Outcome::UpToDate: ++upToDate; break;
+        case Outcome::Skipped:  ++skipped;  continue;
+        case Outcome::Failed:   ++failed;   continue;
+        }
+        updated[jobs[i].key] = results[i].entry;
+    }
+    for (const auto& e : db) {
+        bool stillListed = std::any_of(jobs.begin(), jobs.end(),
+            [&e](const Job& j) { return j.key == e.first && j.output == e.second.output; });
+        std::error_code ec;
+        if (!stillListed && fs::remove(e.second.output, ec))
+            ++removed;
+    }
+    if (!saveDatabase(dbPath, updated))
+        std::cerr << "ERROR::ASSETC::could not write " << dbPath << std::endl;
+
+    // World tiles: rebuilt when the index is missing or its source changed.
+    // Tiles always live under the default output dir, where the runtime
+    // looks for them.
+    size_t tiled = 0;
+    for (const auto& world : worlds) {
+        for (ImportProfile p : profiles) {
+            if (p == ImportProfile::Physics)
+                continue;
+            WorldTiles::Index index;
+            std::vector<std::string> outputs;
+            if (!force && WorldTiles::loadIndex(world, p, index)) {
+                for (const auto& rec : index.tiles)
+                    outputs.push_back(CompiledAsset::meshPathFor(
+                        WorldTiles::tileSource(world, rec.x, rec.z), profileName(p)));
+                outputs.push_back(WorldTiles::indexPathFor(world, p));
+            }
+            else {
+                Assimp::Importer importer;
+                std::string error;
+                if (!WorldTiles::build(world, p, 16, importer, outputs, error)) {
+                    std::cerr << "ERROR::ASSETC::" << world << " tiles: " << error << "\n";
+                    ++failed;
+                    continue;
+                }
+                std::cout << "  " << world << " -> " << outputs.size() - 1 << " tiles ("
+                    << profileName(p) << ")\n";
+                ++tiled;
+            }
+            packFiles.insert(packFiles.end(), outputs.begin(), outputs.end());
+        }
+    }
+
+    bool packFailed = false;
+    if (pack) {
+        const std::string packPath = (fs::path(outDir) / "assets.pack").string();
+        for (const auto& e : updated)
+            packFiles.push_back(e.second.output);
+        std::sort(packFiles.begin(), packFiles.end());
+        packFiles.erase(std::unique(packFiles.begin(), packFiles.end()), packFiles.end());
+        packFiles.erase(std::remove_if(packFiles.begin(), packFiles.end(), [&](const std::string& f) {
+            return AssetPack::keyFor(f) == AssetPack::keyFor(packPath); }), packFiles.end());
+        if (force || built || removed || tiled || packIsStale(packPath, packFiles)) {
+            packFailed = !writePack(packPath, packFiles, compress, threadCount);
+            if (packFailed)
+                std::cerr << "ERROR::ASSETC::could not write " << packPath << std::endl;
+        }
+    }
+
+    std::cout << "assetc: " << built << " built, " << upToDate << " up to date, "
+        << skipped << " skipped, " << failed << " failed, " << removed << " removed in "
+        << std::chrono::duration<double, std::milli>(Clock::now() - start).count()
+        << " ms on " << threadCount << " threads" << std::endl;
+    return failed || packFailed ? 1 : 0;
+}
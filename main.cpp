@@ -1,4 +1,7 @@
-﻿#include <iostream>
+﻿#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
 #include <vector>
 #include <string>
 
@@ -9,152 +12,32 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
-#include <assimp/Importer.hpp>
-#include <assimp/scene.h>
-#include <assimp/postprocess.h>
+#include "AnimationSystem.h"
+#include "AssetPack.h"
+#include "MeshAnalysis.h"
+#include "Model.h"
+#include "ModelCache.h"
+#include "ModelLoader.h"
+#include "PrefetchScheduler.h"
+#include "ProxyBox.h"
+#include "DrawBatch.h"
+#include "Bvh.h"
+#include "Occlusion.h"
+#include "GpuCull.h"
+#include "SceneFile.h"
+#include "TileStreamer.h"
 
-// Vertex structure
-struct Vertex {
-    glm::vec3 Position;
-    glm::vec3 Normal;
-};
 static GLFWwindow* gWindow = nullptr;
 
-
-// Simple Mesh class
-class Mesh {
-public:
-    std::vector<Vertex>       vertices;
-    std::vector<unsigned int> indices;
-    unsigned int              VAO;
-
-    Mesh(const std::vector<Vertex>& verts, const std::vector<unsigned int>& inds)
-        : vertices(verts), indices(inds) {
-        setupMesh();
-    }
-
-    void Draw() const {
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES,
-            static_cast<GLsizei>(indices.size()),
-            GL_UNSIGNED_INT, nullptr);
-        glBindVertexArray(0);
-    }
-
-private:
-    unsigned int VBO, EBO;
-    void setupMesh() {
-        glGenVertexArrays(1, &VAO);
-        glGenBuffers(1, &VBO);
-        glGenBuffers(1, &EBO);
-
-        glBindVertexArray(VAO);
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        glBufferData(GL_ARRAY_BUFFER,
-            vertices.size() * sizeof(Vertex),
-            vertices.data(), GL_STATIC_DRAW);
-
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-            indices.size() * sizeof(unsigned int),
-            indices.data(), GL_STATIC_DRAW);
-
-        // Position attribute
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE,
-            sizeof(Vertex),
-            reinterpret_cast<void*>(offsetof(Vertex, Position)));
-        // Normal attribute
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE,
-            sizeof(Vertex),
-            reinterpret_cast<void*>(offsetof(Vertex, Normal)));
-
-        glBindVertexArray(0);
-    }
-};
-
-// Model loader using 
-class Model {
-public:
-    std::vector<Mesh> meshes;
-
-    Model(const std::string& path) {
-        loadModel(path);
-    }
-
-    void Draw() const {
-        for (const auto& mesh : meshes)
-            mesh.Draw();
-    }
-
-private:
-    void loadModel(const std::string& path) {
-        Assimp::Importer importer;
-        const aiScene* scene = importer.ReadFile(path,
-            aiProcess_Triangulate |
-            aiProcess_FlipUVs |
-            aiProcess_CalcTangentSpace);
-        if (!scene ||
-            scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE ||
-            !scene->mRootNode) {
-            std::cerr << "ERROR::ASSIMP::"
-                << importer.GetErrorString()
-                << std::endl;
-            return;
-        }
-        processNode(scene->mRootNode, scene);
-    }
-
-    void processNode(aiNode* node, const aiScene* scene) {
-        // Process all meshes in node
-        for (unsigned int i = 0; i < node->mNumMeshes; ++i) {
-            aiMesh* ai_mesh = scene->mMeshes[node->mMeshes[i]];
-            meshes.push_back(processMesh(ai_mesh));
-        }
-        // Recursively process children
-        for (unsigned int i = 0; i < node->mNumChildren; ++i)
-            processNode(node->mChildren[i], scene);
-    }
-
-    Mesh processMesh(aiMesh* mesh) {
-        std::vector<Vertex> verts;
-        std::vector<unsigned int> inds;
-
-        // Vertices
-        for (unsigned int i = 0; i < mesh->mNumVertices; ++i) {
-            Vertex v;
-            v.Position = {
-                mesh->mVertices[i].x,
-                mesh->mVertices[i].y,
-                mesh->mVertices[i].z
-            };
-            if (mesh->HasNormals())
-                v.Normal = {
-                    mesh->mNormals[i].x,
-                    mesh->mNormals[i].y,
-                    mesh->mNormals[i].z
-            };
-            else
-                v.Normal = glm::vec3(0.0f);
-            verts.push_back(v);
-        }
-        // Faces (indices)
-        for (unsigned int i = 0; i < mesh->mNumFaces; ++i) {
-            aiFace face = mesh->mFaces[i];
-            for (unsigned int j = 0; j < face.mNumIndices; ++j)
-                inds.push_back(face.mIndices[j]);
-        }
-        return Mesh(verts, inds);
-    }
-};
-
 struct SceneObject {
-    Model* model;      // işaretçi, Draw() çağrısı için
+    ModelHandle model; // paylaşılan model, Draw() çağrısı için
     glm::vec3   position;   // dünya uzayında konum
     glm::vec3   rotation;   // Euler açıları (x,y,z) derece cinsinden
     glm::vec3   scale;      // x,y,z ölçek
 	glm::vec3   color; // Renk (isteğe bağlı, varsayılan beyaz)
+    int         prefetchSet = -1;   // >= 0: model PrefetchScheduler'dan gelir
+    size_t      prefetchIndex = 0;  // set içindeki model sırası
+    int         animation = -1;     // AnimationSystem örneği; -1: bind pozunda çizilir
    
 
     glm::mat4 getModelMatrix() const {
@@ -233,6 +116,12 @@ glm::vec3 cameraUp = { 0.0f, 1.0f,  0.0f };
 extern glm::vec3 cameraPos;
 
 double deltaTime = 0.0, lastFrame = 0.0;
+bool frustumCulling = true;    // F ile açılıp kapanır
+bool occlusionCulling = true;  // O ile açılıp kapanır (frustum culling açıkken)
+bool gpuCulling = false;       // --gpu-cull ya da G: culling compute shader'da
+bool hiZCulling = true;        // Z: GPU culling'de Hi-Z testi
+bool printDrawStats = false;   // bir sonraki karenin çizim sayıları yazılsın
+bool printLookAt = false;      // Space: kameranın baktığı objeyi de yaz
 static glm::vec3 prevCarPos = P_start;            // arabanın bir önceki konumu
 static glm::vec3 prevDir = glm::vec3(0.0f, 0.0f, 1.0f);  // önceki yön (Z+ başlangıç)
 const float policeYOffset = 2.0f;          // polis aracı Y ekseninde +2 yukarıda
@@ -247,6 +136,26 @@ glm::vec3 P_trainEnd = { -166.147f, fixedYPol, -125.873f };
 glm::vec3 P_carTurnStart = P_trainEnd;  // tam tren bittiği yerde başlasın
 glm::vec3 P_carTurnEnd = { -113.102f, fixedY,  -71.7312f };
 
+// Dalın (sol: barikatlar, düz: tren) başlamasına en az kaç saniye kaldığı;
+// o dal artık seçilemiyorsa -1. Kullanıcı bekleyen durumlar 0 sayılır.
+float secondsUntilBranch(bool left) {
+    const float segmentLeft = (1.0f - chaseTimer) * chaseDuration;
+    switch (chaseState) {
+    case ChaseState::IdleAtStart:        return segmentLeft + 3.0f * chaseDuration;
+    case ChaseState::WaitAtRed:          return segmentLeft + 2.0f * chaseDuration;
+    case ChaseState::RedDecision:        return 2.0f * chaseDuration;
+    case ChaseState::ChaseBegin:         return segmentLeft + chaseDuration;
+    case ChaseState::TurnLeftAtJunction: return segmentLeft;
+    case ChaseState::ChoicePoint:        return 0.0f;
+    case ChaseState::BranchLeft:         return left ? 0.0f : -1.0f;
+    case ChaseState::BranchStraight:
+    case ChaseState::FinalStraight:
+    case ChaseState::FinalCarTurn:       return left ? -1.0f : 0.0f;
+    case ChaseState::Finished:           return left == goLeft ? 0.0f : -1.0f;
+    }
+    return -1.0f;
+}
+
 // Space tuşuna basıldığında çağrılacak
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods) {
     if (key == GLFW_KEY_SPACE && action == GLFW_PRESS) {
@@ -256,6 +165,26 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
             << cameraPos.y << ", "
             << cameraPos.z << ")"
             << std::endl;
+        printLookAt = true;
+    }
+    // F: frustum culling aç/kapa, farkı görmek için çizim sayılarını yaz
+    if (key == GLFW_KEY_F && action == GLFW_PRESS) {
+        frustumCulling = !frustumCulling;
+        printDrawStats = true;
+    }
+    // O: büyük binaların arkasında kalanları ayıklamayı aç/kapa
+    if (key == GLFW_KEY_O && action == GLFW_PRESS) {
+        occlusionCulling = !occlusionCulling;
+        printDrawStats = true;
+    }
+    // G: CPU ve GPU culling arasında geçiş, Z: GPU'da Hi-Z testi aç/kapa
+    if (key == GLFW_KEY_G && action == GLFW_PRESS) {
+        gpuCulling = !gpuCulling;
+        printDrawStats = true;
+    }
+    if (key == GLFW_KEY_Z && action == GLFW_PRESS) {
+        hiZCulling = !hiZCulling;
+        printDrawStats = true;
     }
 }
 
@@ -524,6 +453,22 @@ unsigned int createShaderProgram(const char* vertSrc, const char* fragSrc) {
     return program;
 }
 
+unsigned int createComputeProgram(const char* source) {
+    unsigned int program = glCreateProgram();
+    unsigned int cs = compileShader(GL_COMPUTE_SHADER, source);
+    glAttachShader(program, cs);
+    glLinkProgram(program);
+    int success;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) {
+        char info[512];
+        glGetProgramInfoLog(program, 512, nullptr, info);
+        std::cerr << "ERROR::PROGRAM_LINKING_FAILED\n" << info << std::endl;
+    }
+    glDeleteShader(cs);
+    return program;
+}
+
 // Shaders
 const char* vertexShaderSource = R"GLSL(
 #version 430 core
@@ -531,30 +476,201 @@ layout(location = 0) in vec3 aPos;
 layout(location = 1) in vec3 aNormal;
 
 uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+uniform vec3 objectColor;
+
+out vec3 FragPos;
+out vec3 Normal;
+flat out vec3 ObjectColor;
+
+void main() {
+    FragPos = vec3(model * vec4(aPos,1.0));
+    Normal  = mat3(transpose(inverse(model))) * aNormal;
+    ObjectColor = objectColor;
+    gl_Position = projection * view * vec4(FragPos,1.0);
+}
+)GLSL";
+
+// Arena meshleri: model matrisi ve renk, çizim indeksine göre SSBO'dan
+// (DrawBatch). GL 4.3'te gl_DrawID yok; indeks baseInstance ile gelir.
+const char* batchVertexShaderSource = R"GLSL(
+#version 430 core
+layout(location = 0) in vec3 aPos;
+layout(location = 1) in vec3 aNormal;
+layout(location = 2) in uint aDrawId;
+
+struct DrawData {
+    mat4 model;
+    vec4 color;
+};
+layout(std430, binding = 0) readonly buffer Draws {
+    DrawData draws[];
+};
+
 uniform mat4 view;
 uniform mat4 projection;
 
 out vec3 FragPos;
 out vec3 Normal;
+flat out vec3 ObjectColor;
 
 void main() {
+    mat4 model = draws[aDrawId].model;
     FragPos = vec3(model * vec4(aPos,1.0));
     Normal  = mat3(transpose(inverse(model))) * aNormal;
+    ObjectColor = draws[aDrawId].color.rgb;
     gl_Position = projection * view * vec4(FragPos,1.0);
 }
 )GLSL";
 
+// GPU culling (GpuCull): yerleşim başına bir iş parçacığı. Frustum'a ve
+// önceki karenin Hi-Z piramidine göre görünen yerleşim, komutunun
+// instanceCount'unu atomik artırıp DrawData'sını baseInstance + sıraya yazar
+const char* cullComputeShaderSource = R"GLSL(
+#version 430 core
+layout(local_size_x = 64) in;
+
+struct DrawData {
+    mat4 model;
+    vec4 color;
+};
+struct Item {
+    vec3 lo;
+    uint command;
+    vec3 hi;
+    uint pad;
+};
+struct Command {
+    uint count;
+    uint instanceCount;
+    uint firstIndex;
+    int  baseVertex;
+    uint baseInstance;
+};
+layout(std430, binding = 0) writeonly buffer Draws {
+    DrawData draws[];
+};
+layout(std430, binding = 1) readonly buffer Placements {
+    DrawData placements[];
+};
+layout(std430, binding = 2) readonly buffer Items {
+    Item items[];
+};
+layout(std430, binding = 3) buffer Commands {
+    Command commands[];
+};
+
+uniform uint itemCount;
+uniform vec4 planes[6];
+uniform bool frustumTest;
+uniform bool hiZTest;
+uniform sampler2D hiZ;
+uniform mat4 hiZViewProj;
+uniform vec2 hiZSize;
+uniform int  hiZLevels;
+
+bool inFrustum(vec3 lo, vec3 hi) {
+    for (int i = 0; i < 6; ++i) {
+        vec3 p = mix(lo, hi, greaterThanEqual(planes[i].xyz, vec3(0.0)));
+        if (dot(planes[i].xyz, p) + planes[i].w < 0.0)
+            return false;
+    }
+    return true;
+}
+
+// Görünmez sayılması için kutunun en yakın noktası, kapladığı Hi-Z
+// texel'lerinin en uzak derinliğinden de uzak olmalı
+bool passesHiZ(vec3 lo, vec3 hi) {
+    vec2 smin = vec2(1e30), smax = vec2(-1e30);
+    float nearest = 1.0;
+    for (int c = 0; c < 8; ++c) {
+        vec3 p = vec3((c & 1) != 0 ? hi.x : lo.x, (c & 2) != 0 ? hi.y : lo.y, (c & 4) != 0 ? hi.z : lo.z);
+        vec4 q = hiZViewProj * vec4(p, 1.0);
+        if (q.w <= 1e-3)
+            return true;
+        vec3 ndc = q.xyz / q.w;
+        vec2 s = (ndc.xy * 0.5 + 0.5) * hiZSize;
+        smin = min(smin, s);
+        smax = max(smax, s);
+        nearest = min(nearest, ndc.z * 0.5 + 0.5);
+    }
+    // Önceki karede ekran dışında kalan kısım hakkında bilgi yok
+    if (any(lessThan(smin, vec2(0.0))) || any(greaterThanEqual(smax, hiZSize)))
+        return true;
+    ivec2 p0 = ivec2(smin), p1 = ivec2(smax);
+    float extent = float(max(p1.x - p0.x, p1.y - p0.y));
+    int level = clamp(int(ceil(log2(max(extent, 1.0)))), 0, hiZLevels - 1);
+    ivec2 size = textureSize(hiZ, level);
+    ivec2 t0 = min(p0 >> level, size - 1), t1 = min(p1 >> level, size - 1);
+    float farthest = 0.0;
+    for (int y = t0.y; y <= t1.y; ++y)
+        for (int x = t0.x; x <= t1.x; ++x)
+            farthest = max(farthest, texelFetch(hiZ, ivec2(x, y), level).r);
+    return nearest <= farthest + 1e-6;
+}
+
+void main() {
+    uint i = gl_GlobalInvocationID.x;
+    if (i >= itemCount || items[i].command == 0xFFFFFFFFu)
+        return;   // boş yuva
+    vec3 lo = items[i].lo, hi = items[i].hi;
+    bool unbounded = any(greaterThan(hi - lo, vec3(1e30)));
+    if (!unbounded) {
+        if (frustumTest && !inFrustum(lo, hi))
+            return;
+        if (hiZTest && !passesHiZ(lo, hi))
+            return;
+    }
+    uint c = items[i].command;
+    uint slot = atomicAdd(commands[c].instanceCount, 1u);
+    draws[commands[c].baseInstance + slot] = placements[i];
+}
+)GLSL";
+
+// Hi-Z piramidi: seviye 0 derinlik kopyası, her seviye bir alttakinin 2x2
+// (tek kenarda 3) bloklarının en uzağı
+const char* hiZComputeShaderSource = R"GLSL(
+#version 430 core
+layout(local_size_x = 8, local_size_y = 8) in;
+
+uniform sampler2D source;
+uniform int  sourceLevel;
+uniform bool downsample;
+layout(r32f, binding = 0) writeonly uniform image2D target;
+
+void main() {
+    ivec2 p = ivec2(gl_GlobalInvocationID.xy);
+    ivec2 size = imageSize(target);
+    if (any(greaterThanEqual(p, size)))
+        return;
+    if (!downsample) {
+        imageStore(target, p, vec4(texelFetch(source, p, 0).r));
+        return;
+    }
+    ivec2 sourceSize = textureSize(source, sourceLevel);
+    ivec2 last = ivec2(1);
+    if (p.x == size.x - 1 && (sourceSize.x & 1) != 0) last.x = 2;
+    if (p.y == size.y - 1 && (sourceSize.y & 1) != 0) last.y = 2;
+    float d = 0.0;
+    for (int y = 0; y <= last.y; ++y)
+        for (int x = 0; x <= last.x; ++x)
+            d = max(d, texelFetch(source, min(p * 2 + ivec2(x, y), sourceSize - 1), sourceLevel).r);
+    imageStore(target, p, vec4(d));
+}
+)GLSL";
+
 const char* fragmentShaderSource = R"GLSL(
 #version 430 core
 out vec4 FragColor;
 
 in vec3 FragPos;
 in vec3 Normal;
+flat in vec3 ObjectColor;
 
 uniform vec3 lightPos;
 uniform vec3 viewPos;
 uniform vec3 lightColor;
-uniform vec3 objectColor;
 
 
 void main() {
@@ -567,7 +683,7 @@ void main() {
     vec3 reflectDir= reflect(-lightDir, norm);
     float spec   = pow(max(dot(viewDir, reflectDir), 0.0), 32);
     vec3 specular= 0.5 * spec * lightColor;
-    vec3 result  = (ambient + diffuse + specular) * objectColor;
+    vec3 result  = (ambient + diffuse + specular) * ObjectColor;
     FragColor    = vec4(result,1.0);
 }
 )GLSL";
@@ -577,8 +693,170 @@ void framebuffer_size_callback(GLFWwindow* window, int w, int h) {
     glViewport(0, 0, w, h);
 }
 
+// --bench-import: aiMesh -> Vertex dönüşümünü eski (alan alan push_back)
+// ve yeni (toplu SIMD) yol ile karşılaştırır. Pencere/GL gerektirmez.
+static MeshData processMeshBaseline(const aiMesh* mesh) {
+    MeshData out;
+    for (unsigned int i = 0; i < mesh->mNumVertices; ++i) {
+        Vertex v;
+        v.Position = { mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z };
+        if (mesh->HasNormals())
+            v.Normal = { mesh->mNormals[i].x, mesh->mNormals[i].y, mesh->mNormals[i].z };
+        else
+            v.Normal = glm::vec3(0.0f);
+        out.vertices.push_back(v);
+    }
+    for (unsigned int i = 0; i < mesh->mNumFaces; ++i) {
+        aiFace face = mesh->mFaces[i];
+        for (unsigned int j = 0; j < face.mNumIndices; ++j)
+            out.indices.push_back(face.mIndices[j]);
+    }
+    return out;
+}
+
+int runImportBenchmark(const std::vector<std::string>& files) {
+    using Clock = std::chrono::steady_clock;
+    const int iterations = 20;
+    for (const auto& path : files) {
+        Assimp::Importer importer;
+        auto t0 = Clock::now();
+        configureImporter(importer, ImportProfile::RenderOptimized);
+        const aiScene* scene = importer.ReadFile(path, importFlagsFor(ImportProfile::RenderOptimized));
+        auto t1 = Clock::now();
+        if (!scene || !scene->mRootNode) {
+            std::cerr << path << ": " << importer.GetErrorString() << std::endl;
+            continue;
+        }
+        size_t verts = 0, inds = 0;
+        for (unsigned int m = 0; m < scene->mNumMeshes; ++m) {
+            verts += scene->mMeshes[m]->mNumVertices;
+            inds += scene->mMeshes[m]->mNumFaces * 3;
+        }
+
+        auto timeIt = [&](MeshData (*convert)(const aiMesh*)) {
+            size_t sink = 0;
+            auto start = Clock::now();
+            for (int it = 0; it < iterations; ++it)
+                for (unsigned int m = 0; m < scene->mNumMeshes; ++m)
+                    sink += convert(scene->mMeshes[m]).indices.size();
+            double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+            return sink ? ms / iterations : 0.0;
+        };
+        double baseMs = timeIt(processMeshBaseline);
+        double fastMs = timeIt(processMesh);
+
+        std::cout << path << "\n"
+            << "  meshes " << scene->mNumMeshes << ", vertices " << verts << ", indices " << inds << "\n"
+            << "  ReadFile          " << std::chrono::duration<double, std::milli>(t1 - t0).count() << " ms\n"
+            << "  processMesh old   " << baseMs << " ms\n"
+            << "  processMesh bulk  " << fastMs << " ms"
+#ifdef VERTEX_CONVERT_SSE
+            << " (SSE)"
+#endif
+            << "\n"
+            << "  speedup           " << (fastMs > 0.0 ? baseMs / fastMs : 0.0) << "x" << std::endl;
+    }
+    return 0;
+}
+
+// --analyze: modelleri uygulamanın yükleme yolundan (importModel) geçirip
+// her profil için verimlilik ölçülerini yazar. Pencere/GL gerektirmez.
+int runImportAnalysis(const std::vector<std::string>& files, const std::vector<ImportProfile>& profiles) {
+    for (const auto& path : files) {
+        const char* best = nullptr;
+        size_t bestRuns = 0, bestDraws = 0;
+        for (ImportProfile profile : profiles) {
+            Assimp::Importer importer;
+            ModelData data = importModel(path, importer, profile);
+            if (!data.ok) {
+                std::cerr << path << ": import failed (" << profileName(profile) << ")" << std::endl;
+                continue;
+            }
+            const MeshAnalysis::ModelReport report = MeshAnalysis::analyzeModel(data);
+            MeshAnalysis::printReport(std::cout, report);
+            // Fewest vertex shader runs wins, then fewest draws
+            const size_t runs = report.total.cacheMisses, draws = report.meshes.size();
+            if (!best || runs < bestRuns || (runs == bestRuns && draws < bestDraws)) {
+                best = profileName(profile);
+                bestRuns = runs;
+                bestDraws = draws;
+            }
+        }
+        if (best && profiles.size() > 1)
+            std::cout << path << ": best profile " << best << " (" << bestRuns
+                << " vertex shader runs, " << bestDraws << " draws)\n";
+        std::cout << std::endl;
+    }
+    return 0;
+}
+
 void updateChase(GLFWwindow* window, float dt);
-int main() {
+int main(int argc, char** argv) {
+    const auto appStart = std::chrono::steady_clock::now();
+    // Komut satırı araçları
+    if (argc > 1 && std::string(argv[1]) == "--bench-import") {
+        std::vector<std::string> files(argv + 2, argv + argc);
+        if (files.empty())
+            files = { "assets/models/police/scene.gltf", "models/city.obj" };
+        return runImportBenchmark(files);
+    }
+    // --analyze [--profile NAME]... [dosyalar]: hangi modeller kare bütçesini yiyor
+    if (argc > 1 && std::string(argv[1]) == "--analyze") {
+        std::vector<std::string> files;
+        std::vector<ImportProfile> profiles;
+        for (int i = 2; i < argc; ++i) {
+            ImportProfile p;
+            if (std::string(argv[i]) == "--profile" && i + 1 < argc) {
+                if (!parseProfile(argv[++i], p)) {
+                    std::cerr << "Unknown import profile: " << argv[i] << std::endl;
+                    return -1;
+                }
+                profiles.push_back(p);
+            }
+            else {
+                files.push_back(argv[i]);
+            }
+        }
+        if (files.empty())
+            files = { "models/city.obj", "models/policecar.obj", "assets/models/police/scene.gltf" };
+        if (profiles.empty())
+            profiles = { ImportProfile::FastLoad, ImportProfile::RenderOptimized };
+        return runImportAnalysis(files, profiles);
+    }
+    // --profile fast-load|render-optimized|physics
+    ImportProfile importProfile = ImportProfile::RenderOptimized;
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (std::string(argv[i]) == "--profile" && !parseProfile(argv[i + 1], importProfile)) {
+            std::cerr << "Unknown import profile: " << argv[i + 1] << std::endl;
+            return -1;
+        }
+    }
+    // --progressive: modeller yüklenirken çiz, yüklenmeyenler için kutu göster
+    bool progressive = false;
+    for (int i = 1; i < argc; ++i)
+        if (std::string(argv[i]) == "--progressive")
+            progressive = true;
+    // --gpu-cull: görünürlük (frustum + Hi-Z) compute shader'da, G ile değişir
+    for (int i = 1; i < argc; ++i)
+        if (std::string(argv[i]) == "--gpu-cull")
+            gpuCulling = true;
+    // --gpu-budget MB: tüm modeller için GPU bellek sınırı (LRU ile atılır)
+    size_t gpuBudget = 0;
+    for (int i = 1; i + 1 < argc; ++i)
+        if (std::string(argv[i]) == "--gpu-budget")
+            gpuBudget = size_t(std::max(1, std::atoi(argv[i + 1]))) << 20;
+    // --world-budget MB: şehir karoları için GPU bellek sınırı
+    TileStreamer::Settings worldSettings;
+    for (int i = 1; i + 1 < argc; ++i)
+        if (std::string(argv[i]) == "--world-budget")
+            worldSettings.budgetBytes = size_t(std::max(1, std::atoi(argv[i + 1]))) << 20;
+    // --scene PATH: sahne metni; değiştiyse compiled/ altına yeniden derlenir,
+    // ikili hali tek mmap ile açılır
+    std::string scenePath = "assets/chase.scene";
+    for (int i = 1; i + 1 < argc; ++i)
+        if (std::string(argv[i]) == "--scene")
+            scenePath = argv[i + 1];
+
     // Init GLFW
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
@@ -607,103 +885,337 @@ int main() {
     }
     glEnable(GL_DEPTH_TEST);
     gWindow = window;
+    // Statik meshler ortak vertex/index arenalarından yer alır
+    MeshArena::init();
 
 
     // Compile & link shaders
     unsigned int shaderProgram = createShaderProgram(vertexShaderSource, fragmentShaderSource);
+    unsigned int batchProgram = createShaderProgram(batchVertexShaderSource, fragmentShaderSource);
+    unsigned int cullProgram = createComputeProgram(cullComputeShaderSource);
+    unsigned int hiZProgram = createComputeProgram(hiZComputeShaderSource);
 
     // Load model
    // 1) Birden fazla Model örneği
-    Model carModel("models/Datsun_280Z.obj");
-    Model traficlightModel("models/trafficlight.obj");
-	Model cityModel("models/city.obj");
-    Model barricadeModel("models/Concrete_Barricade.obj");
-    Model trainModel("models/electrictrain.obj");
-    Model mondeoModel("models/Mondeo_NYPD.obj");
-    Model policecarModel("models/policecar.obj");
-    carObj = { &carModel,     P_start,    glm::vec3(0.0f), glm::vec3(3.0f), glm::vec3(0.8f,0.7f,0.0f) };
-    policeObj = { &policecarModel,{113.545f,fixedY+2.0f,-257.034f}, glm::vec3(0.0f), glm::vec3(5.0f), glm::vec3(0.0f,0.0f,0.5f) };
-    trainObj = { &trainModel,
-              P_trainStart,           // yukarıda tanımladığın waypoint
-              glm::vec3(0.0f),        // rotation = 0
-              glm::vec3(1.3f),        // modeline uygun scale
-              glm::vec3(0.6f,0.3f,0.1f) // kahverengi tonu
+    // Import on worker threads, upload on this (context) thread.
+    // Aynı dosya iki kez istenirse aynı Model paylaşılır.
+    // assetc --pack çıktısı varsa dosyalar önce paketten okunur
+    if (AssetFiles::mountPack("compiled/assets.pack"))
+        std::cout << "Asset paketi yüklendi: compiled/assets.pack\n";
+    SceneFile::Scene sceneFile;
+    std::string sceneError;
+    if (!SceneFile::load(scenePath, sceneFile, sceneError)) {
+        std::cerr << "ERROR::SCENE::" << sceneError << std::endl;
+        MeshArena::shutdown();
+        glfwTerminate();
+        return -1;
+    }
+    // Sahnedeki waypoint'ler varsayılanların yerine geçer
+    const std::pair<const char*, glm::vec3*> namedWaypoints[] = {
+        { "start", &P_start }, { "fullLeft", &P_fullLeft }, { "redLight", &P_redLight },
+        { "chase0", &P_chase0 }, { "junction", &P_junction }, { "barricade", &P_barricade },
+        { "train", &P_train }, { "trainStart", &P_trainStart }, { "trainEnd", &P_trainEnd },
+        { "carTurnEnd", &P_carTurnEnd } };
+    for (const auto& wp : namedWaypoints)
+        sceneFile.findWaypoint(wp.first, glm::value_ptr(*wp.second));
+    P_carTurnStart = P_trainEnd;
+    prevCarPos = P_start;
+    // Geometri işçi thread'lerde kalıcı map'li staging ring'e kopyalanır
+    UploadRing uploadRing;
+    if (!uploadRing.init((GLADloadproc)glfwGetProcAddress))
+        std::cout << "Upload ring yok (GL_ARB_buffer_storage), doğrudan yükleniyor\n";
+    ModelLoader loader(&uploadRing);
+    ModelCache models(loader);
+    models.setBudget(gpuBudget);
+    // Gruplu modeller (dallara özel) baştan değil, dal yaklaşınca yüklenir:
+    // her grup bir prefetch seti, alanları da aynı adlı "area" satırları
+    PrefetchScheduler prefetch(models, importProfile);
+    std::vector<std::string> groups;
+    std::vector<PrefetchScheduler::Set> groupSets;
+    std::vector<int> modelSet(sceneFile.modelCount(), -1);
+    std::vector<size_t> modelSlot(sceneFile.modelCount(), 0);
+    auto groupIndex = [&](const char* name) {
+        return int(std::find(groups.begin(), groups.end(), name) - groups.begin());
     };
+    for (size_t i = 0; i < sceneFile.modelCount(); ++i) {
+        const SceneFile::ModelRecord& m = sceneFile.model(i);
+        if (m.group == SceneFile::kNone)
+            continue;
+        int g = groupIndex(sceneFile.str(m.group));
+        if (g == int(groups.size())) {
+            groups.push_back(sceneFile.str(m.group));
+            groupSets.emplace_back();
+        }
+        modelSet[i] = g;
+        modelSlot[i] = groupSets[g].models.size();
+        groupSets[g].models.push_back(sceneFile.str(m.path));
+    }
+    for (size_t i = 0; i < sceneFile.areaCount(); ++i) {
+        const int g = groupIndex(sceneFile.str(sceneFile.area(i).name));
+        if (g < int(groups.size()))
+            groupSets[g].areas.push_back(glm::make_vec3(sceneFile.area(i).position));
+    }
+    for (const auto& set : groupSets)
+        prefetch.addSet(set);
+    const int leftSet = groupIndex("left") < int(groups.size()) ? groupIndex("left") : -1;
+    const int straightSet = groupIndex("straight") < int(groups.size()) ? groupIndex("straight") : -1;
+    // Kovalamacanın bilmediği gruplar hemen istenir
+    auto secondsUntilSet = [&](int set) {
+        if (set == leftSet)
+            return secondsUntilBranch(true);
+        if (set == straightSet)
+            return secondsUntilBranch(false);
+        return 0.0f;
+    };
+    // Öncelikler sahne kurulunca verilir, o zamana kadar işçiler bekler
+    loader.pause();
+    std::vector<ModelHandle> sceneModels(sceneFile.modelCount());
+    for (size_t i = 0; i < sceneFile.modelCount(); ++i)
+        if (modelSet[i] < 0)
+            sceneModels[i] = models.loadAsync(sceneFile.str(sceneFile.model(i).path), importProfile);
     int uModelLoc = glGetUniformLocation(shaderProgram, "model");
     int uColorLoc = glGetUniformLocation(shaderProgram, "objectColor");
     // 2) Sahne objelerini tutacak vektör
     std::vector<SceneObject> scene;
+    scene.reserve(sceneFile.objectCount());
+
+    // 3) Objeler sahne dosyasından: adı olanlar kovalamaca aktörleri, gerisi statik
+    auto placed = [](const SceneFile::Placement& p) {
+        SceneObject obj;
+        obj.position = glm::make_vec3(p.position);
+        obj.rotation = glm::make_vec3(p.rotation);
+        obj.scale = glm::make_vec3(p.scale);
+        obj.color = glm::make_vec3(p.color);
+        return obj;
+    };
+    for (size_t i = 0; i < sceneFile.objectCount(); ++i) {
+        const SceneFile::ObjectRecord& rec = sceneFile.object(i);
+        SceneObject obj = placed(rec.placement);
+        if (modelSet[rec.model] < 0) {
+            obj.model = sceneModels[rec.model];
+        }
+        else {
+            obj.prefetchSet = modelSet[rec.model];
+            obj.prefetchIndex = modelSlot[rec.model];
+        }
+        const std::string name = sceneFile.str(rec.name);
+        if (rec.name == SceneFile::kNone)
+            scene.push_back(obj);
+        else if (name == "car")
+            carObj = obj;
+        else if (name == "police")
+            policeObj = obj;
+        else if (name == "train")
+            trainObj = obj;
+        else
+            std::cerr << "WARNING::SCENE::unknown actor " << name << std::endl;
+    }
 
-    // 3) Örnek objeler ekle
-   // Şehir (beyaz-gri)
-    scene.push_back({ &cityModel,
+    // Şehir (beyaz-gri): tek model yerine karolar halinde, arabanın
+    // etrafındakiler bütçe dahilinde yüklenir
+    SceneObject cityObj = { nullptr,
         glm::vec3(0.0f,0.0f,0.0f),
         glm::vec3(0.0f),
         glm::vec3(0.008f),
         glm::vec3(0.9f,0.9f,0.9f)
-        });
-
-
-    // Kaçan araba (koyu sarı)
-    //scene.push_back({ &carModel,
-    //    glm::vec3(100.201f, 1.558f, -48.558f),  // başlangıç poz
-    //   glm::vec3(-0.33f, 137.11f, 0.0f),
-    //    glm::vec3(2.0f),
-    //    glm::vec3(0.8f,0.7f,0.0f)
-    //    });
-
-    // Trafik lambası (gri)
-    scene.push_back({ &traficlightModel,
-        glm::vec3(101.805f,0.18172f,-218.785),
-        glm::vec3(0.0f, 60.0f, 0.0f),
-        glm::vec3(1.0f),
-        glm::vec3(0.5f,0.5f,0.5f)
-        });
-
-    // Barikatlar (3 adet, koyu gri)
-    scene.push_back({ &barricadeModel,
-        glm::vec3(-42.8973f, 2.56963f, -186.734f),
-        glm::vec3(0.0f), glm::vec3(1.655f), glm::vec3(0.2f)
-        });
-    scene.push_back({ &barricadeModel,
-        glm::vec3(-47.2592f, 2.32627f, -182.464f),
-        glm::vec3(0.0f), glm::vec3(1.655f), glm::vec3(0.2f)
-        });
-    scene.push_back({ &barricadeModel,
-        glm::vec3(-37.2264f, 2.12073f, -189.842f),
-        glm::vec3(0.0f), glm::vec3(1.655f), glm::vec3(0.2f)
-        });
+        };
+    std::string worldPath = "models/city.obj";
+    if (sceneFile.worldCount() > 0) {
+        cityObj = placed(sceneFile.world(0).placement);
+        worldPath = sceneFile.str(sceneFile.world(0).path);
+        if (sceneFile.worldCount() > 1)
+            std::cerr << "WARNING::SCENE::only the first world is streamed" << std::endl;
+    }
+    TileStreamer world(models, worldPath, importProfile, worldSettings);
+
+
+    // Animasyonlu düğümleri olan modeller (tekerlek, tepe lambası) yüklenince
+    // oynatılır; düğümü olmayanlar için örnek boş kalır
+    AnimationSystem animations;
+    for (auto* obj : { &carObj, &policeObj, &trainObj })
+        if (obj->model)
+            obj->animation = animations.add(obj->model);
+    for (auto& obj : scene)
+        if (obj.model)
+            obj.animation = animations.add(obj.model);
+
+    // Kovalamaca başlangıcına (P_start) yakın modeller önce yüklenir
+    auto distanceToStart = [](const SceneObject& obj) {
+        if (!obj.model || !obj.model->hasBounds())
+            return glm::distance(obj.position, P_start);
+        // Dünya uzayındaki kutuya uzaklık (kutu içindeyse 0)
+        glm::mat4 M = obj.getModelMatrix();
+        glm::vec3 lo(1e30f), hi(-1e30f);
+        for (int c = 0; c < 8; ++c) {
+            glm::vec3 corner((c & 1) ? obj.model->getBoundsMax().x : obj.model->getBoundsMin().x,
+                             (c & 2) ? obj.model->getBoundsMax().y : obj.model->getBoundsMin().y,
+                             (c & 4) ? obj.model->getBoundsMax().z : obj.model->getBoundsMin().z);
+            glm::vec3 w = glm::vec3(M * glm::vec4(corner, 1.0f));
+            lo = glm::min(lo, w);
+            hi = glm::max(hi, w);
+        }
+        return glm::distance(glm::clamp(P_start, lo, hi), P_start);
+    };
+    for (const auto* obj : { &carObj, &policeObj, &trainObj })
+        models.prioritize(obj->model, distanceToStart(*obj));
+    for (const auto& obj : scene)
+        models.prioritize(obj.model, distanceToStart(obj));
+    // Kovalamaca durumuna göre dal modellerini iste / iptal et ve bağla.
+    // Tutamak değişince animasyon örneği de değişir: örnek modeli tuttuğundan
+    // bırakılan modelin örneği silinir, yoksa model bellekten düşmez
+    uint64_t bindVersion = 0;   // GPU culling'in kalıcı yerleşimleri için
+    auto bindPrefetched = [&](SceneObject& obj) {
+        const ModelHandle& model = prefetch.model(obj.prefetchSet, obj.prefetchIndex);
+        if (model == obj.model)
+            return;
+        animations.remove(obj.animation);
+        obj.animation = model ? animations.add(model) : -1;
+        obj.model = model;
+        ++bindVersion;
+    };
+    auto updatePrefetch = [&] {
+        for (int set = 0; set < int(groups.size()); ++set)
+            prefetch.update(set, secondsUntilSet(set));
+        for (auto* obj : { &carObj, &policeObj, &trainObj })
+            if (obj->prefetchSet >= 0)
+                bindPrefetched(*obj);
+        for (auto& obj : scene)
+            if (obj.prefetchSet >= 0)
+                bindPrefetched(obj);
+    };
+    updatePrefetch();
+    world.update(P_start, cityObj.getModelMatrix(), prefetch.tilePrefetch());
+    loader.resume();
+    if (!progressive) {
+        loader.finish();
+        std::cout << "Model yükleme:\n";
+        models.printStats(std::cout);
+    }
 
-    // Tren (kahverengi)
-    /*scene.push_back({ &trainModel,
-        glm::vec3(-244.204f,1.31191,-174.878f),
-        glm::vec3(0.0f,60.0f,0.0f),
-        glm::vec3(1.3f),
-        glm::vec3(0.6f,0.3f,0.1f)
-        });*/
-
-    // Mondeo (mavi) — barikat civarında 2 adet
-    scene.push_back({ &mondeoModel,
-        glm::vec3(-42.3781f, 1.87126f, -173.417f),
-        glm::vec3(0.0f,0.0f,0.0f),
-        glm::vec3(0.061f),
-        glm::vec3(0.0f,0.0f,1.0f)
-        });
-    scene.push_back({ &mondeoModel,
-        glm::vec3(-29.6428f, 2.08468f, -182.543f),
-        glm::vec3(0.0f,270.0f,0.0f),
-        glm::vec3(0.061f),
-        glm::vec3(0.0f,0.0f,1.0f)
+    auto proxyBox = std::make_unique<ProxyBox>();
+    // Hazır modeller kareye toplanır, aynı mesh'in kopyaları tek instanced
+    // komutta; kare sonunda birkaç glMultiDrawElementsIndirect ile çizilir
+    DrawBatch batch;
+    GpuCull gpuCull(cullProgram, hiZProgram);
+    auto drawObject = [&](const SceneObject& obj, int uModelLoc, int uColorLoc) {
+        if (!obj.model)
+            return;   // henüz istenmemiş dal modeli
+        glm::mat4 M = obj.getModelMatrix();
+        if (obj.model->isReady()) {
+            batch.add(*obj.model, M, obj.color, animations.nodeMatrices(obj.animation));
+        }
+        else {
+            // Yüklenene (ya da bellekten atıldıysa geri yüklenene) kadar
+            // soluk renkli sınır kutusu
+            obj.model->touch();
+            glm::vec3 faded = obj.color * 0.5f + glm::vec3(0.25f);
+            glUniform3fv(uColorLoc, 1, glm::value_ptr(faded));
+            proxyBox->Draw(uModelLoc, M, *obj.model);
+        }
+    };
+    // Statik objeler, şehir karoları ve aktörler tek BVH'de. Kutusu
+    // bilinmeyen obje (model henüz istenmedi) dışarıda kalır, kutusu
+    // olmayan model her zaman çizilir. Küme değişince yeniden kurulur,
+    // yoksa sadece refit (hareket eden aktörler için)
+    Bvh::Tree sceneBvh;
+    const SceneObject* const actors[] = { &carObj, &policeObj, &trainObj };
+    // Öğe numaraları: [0, scene) objeler, sonra karolar, sonra aktörler
+    // (karo indeksi ilk açılışta henüz kuruluyor olabilir)
+    const size_t tileItems = scene.size();
+    auto actorItems = [&] { return tileItems + world.tileCount(); };
+    std::vector<glm::vec3> bvhLo, bvhHi;
+    std::vector<uint32_t> bvhItems, bvhBuiltItems, unboundedItems;
+    auto itemObject = [&](uint32_t item) -> const SceneObject* {
+        if (item < tileItems)
+            return &scene[item];
+        if (item >= actorItems())
+            return actors[item - actorItems()];
+        return nullptr;   // şehir karosu
+    };
+    auto updateSceneBvh = [&] {
+        bvhLo.clear();
+        bvhHi.clear();
+        bvhItems.clear();
+        unboundedItems.clear();
+        auto addObject = [&](uint32_t item, const SceneObject& obj) {
+            if (!obj.model)
+                return;
+            if (!obj.model->hasBounds()) {
+                unboundedItems.push_back(item);
+                return;
+            }
+            glm::vec3 lo, hi;
+            FrustumCull::transformBox(obj.getModelMatrix(), obj.model->getBoundsMin(),
+                obj.model->getBoundsMax(), lo, hi);
+            bvhItems.push_back(item);
+            bvhLo.push_back(lo);
+            bvhHi.push_back(hi);
+        };
+        for (size_t i = 0; i < scene.size(); ++i)
+            addObject(uint32_t(i), scene[i]);
+        // Karo kutuları indeksten gelir, istenmemiş karolar da ağaçta kalır
+        world.forEachTile([&](size_t i, const glm::vec3& lo, const glm::vec3& hi, const ModelHandle&) {
+            bvhItems.push_back(uint32_t(tileItems + i));
+            bvhLo.push_back(lo);
+            bvhHi.push_back(hi);
         });
-
-    // Polis arabaları (koyu mavi) 
-   /* glm::vec3 pStart(113.545f, 3.1282f, -257.034f);
-    scene.push_back({ &policecarModel,
-        pStart,
-        glm::vec3(0.0f),
-        glm::vec3(5.0f),
-        glm::vec3(0.0f,0.0f,0.5f)
-        });*/
+        for (size_t i = 0; i < 3; ++i)
+            addObject(uint32_t(actorItems() + i), *actors[i]);
+        if (bvhItems != bvhBuiltItems) {
+            sceneBvh.build(bvhLo, bvhHi);
+            bvhBuiltItems = bvhItems;
+        }
+        else {
+            sceneBvh.refit(bvhLo, bvhHi);
+        }
+    };
+    // Occlusion: yakındaki büyük modellerin en büyük üçgenleri küçük bir
+    // derinlik tamponuna çizilir, arkalarında kalan obje/karo/mesh atlanır
+    Occlusion::Culler occlusion;
+    const float occluderRange = 150.0f;        // bundan uzak modeller örtmez
+    const size_t occluderBudget = 24 * 1024;   // kare başına en çok üçgen
+    std::vector<uint32_t> frustumVisible;      // bvhItems indeksleri
+    std::vector<std::pair<float, uint32_t>> occluderOrder;
+    auto itemModel = [&](uint32_t item) -> const Model* {
+        if (const SceneObject* obj = itemObject(item))
+            return obj->model.get();
+        return world.tileModel(item - tileItems).get();
+    };
+    auto itemMatrix = [&](uint32_t item) {
+        const SceneObject* obj = itemObject(item);
+        return obj ? obj->getModelMatrix() : cityObj.getModelMatrix();
+    };
+    auto drawItem = [&](uint32_t item) {
+        if (const SceneObject* obj = itemObject(item)) {
+            drawObject(*obj, uModelLoc, uColorLoc);
+            return;
+        }
+        SceneObject tile = cityObj;
+        tile.model = world.tileModel(item - tileItems);
+        drawObject(tile, uModelLoc, uColorLoc);
+    };
+    // GPU culling: hazır ve animasyonsuz obje/karo modelleri batch'te kalıcı
+    // durur, sadece yüklenince, atılınca ya da tutamağı değişince yeniden
+    // yazılır. Geri kalanı (yüklenmemiş, animasyonlu, aktörler) her kare
+    auto residentModel = [&](uint32_t item) -> const Model* {
+        const Model* model = itemModel(item);
+        if (!model || !model->isReady())
+            return nullptr;
+        const SceneObject* obj = itemObject(item);
+        if (obj && obj->animation >= 0 && !model->getNodes().empty())
+            return nullptr;
+        return model;
+    };
+    // Kalıcı modellerin dünya kutuları ayrı bir BVH'de: sadece frustum'a
+    // değenler kullanılmış sayılır, yoksa bütçe hiçbirini atamaz
+    bool residentValid = false;
+    uint64_t residentVersion = 0;
+    std::vector<uint32_t> perFrameItems;
+    std::vector<const Model*> residentModels, unboundedResident;   // BVH sırası / kutusuz
+    std::vector<glm::vec3> residentLo, residentHi;
+    Bvh::Tree residentBvh;
+    bool firstFrame = true, fullFidelity = false;
+    std::vector<bool> branchReported(groups.size(), false);
     lastFrame = (float)glfwGetTime();
     // Render loop
     while (!glfwWindowShouldClose(window)) {
@@ -720,6 +1232,35 @@ int main() {
         // 3) Chase mantığını güncelle
         updateChase(window, dt);
 
+        // Şehir karoları: serbest kamerada kameranın, takipte arabanın
+        // (ön görüşte biraz ilerisinin) çevresi yüklü tutulur
+        glm::vec3 worldFocus = carObj.position;
+        if (camMode == CameraMode::Free) {
+            worldFocus = cameraPos;
+        }
+        else if (camMode == CameraMode::FrontPOV) {
+            glm::vec3 fw(sin(glm::radians(carObj.rotation.y)), 0.0f, cos(glm::radians(carObj.rotation.y)));
+            worldFocus += fw * (0.5f * worldSettings.loadRadius);
+        }
+        updatePrefetch();
+        world.update(worldFocus, cityObj.getModelMatrix(), prefetch.tilePrefetch());
+        // Dal başladığında modelleri hazır mıydı?
+        for (int set : { leftSet, straightSet }) {
+            if (set < 0)
+                continue;
+            const bool started = secondsUntilSet(set) == 0.0f &&
+                chaseState != ChaseState::ChoicePoint;
+            if (started && !branchReported[set]) {
+                branchReported[set] = true;
+                std::cout << (set == leftSet ? "Sol" : "Düz") << " dal başladı, modeller "
+                    << (prefetch.resident(set) ? "hazır" : "henüz yüklenmedi") << std::endl;
+            }
+        }
+
+        // Biten asenkron yüklemeleri GPU'ya aktar (kare başına ~4 ms)
+        models.update(progressive ? 4.0 : 0.0);
+        animations.update(dt);
+
         // 4) Temizle ve shader’ı seç
         glClearColor(0.1f, 0.1f, 0.12f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -775,35 +1316,241 @@ int main() {
         };
 
        
-        glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "projection"),
-            1, GL_FALSE, glm::value_ptr(proj));
-        glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "view"),
-            1, GL_FALSE, glm::value_ptr(view));
-
-        // 6) Işık ve genel color (statik)
-        glUniform3f(glGetUniformLocation(shaderProgram, "lightPos"), 5.0f, 5.0f, 5.0f);
-        glUniform3fv(glGetUniformLocation(shaderProgram, "viewPos"), 1, glm::value_ptr(cameraPos));
-        glUniform3f(glGetUniformLocation(shaderProgram, "lightColor"), 1.0f, 1.0f, 1.0f);
-
-        // 7) Dinamik chase objeler
-        for (auto* dyn : { &carObj, &policeObj, &trainObj }) {
-            glm::mat4 M = dyn->getModelMatrix();
-            glUniformMatrix4fv(uModelLoc, 1, GL_FALSE, glm::value_ptr(M));
-            glUniform3fv(uColorLoc, 1, glm::value_ptr(dyn->color));
-            dyn->model->Draw();
+        // 6) Kamera ve ışık her iki programda da aynı
+        for (unsigned int program : { batchProgram, shaderProgram }) {
+            glUseProgram(program);
+            glUniformMatrix4fv(glGetUniformLocation(program, "projection"),
+                1, GL_FALSE, glm::value_ptr(proj));
+            glUniformMatrix4fv(glGetUniformLocation(program, "view"),
+                1, GL_FALSE, glm::value_ptr(view));
+            glUniform3f(glGetUniformLocation(program, "lightPos"), 5.0f, 5.0f, 5.0f);
+            glUniform3fv(glGetUniformLocation(program, "viewPos"), 1, glm::value_ptr(cameraPos));
+            glUniform3f(glGetUniformLocation(program, "lightColor"), 1.0f, 1.0f, 1.0f);
         }
 
-        // 8) Statik sahne objeleri (statik listeye araba/polis eklemeyin)
-        for (const auto& obj : scene) {
-            glm::mat4 M = obj.getModelMatrix();
-            glUniformMatrix4fv(uModelLoc, 1, GL_FALSE, glm::value_ptr(M));
-            glUniform3fv(uColorLoc, 1, glm::value_ptr(obj.color));
-            obj.model->Draw();
+        // Görünmeyen meshler flush'ta frustum'a göre elenir
+        batch.begin(proj * view);
+        batch.setCulling(frustumCulling);
+
+        // GPU culling'de statik olanlar batch'te kalıcı, eleme compute shader'da
+        batch.setGpuCulling(gpuCulling ? &gpuCull : nullptr);
+        gpuCull.setHiZ(hiZCulling);
+        const glm::mat4 eye = glm::inverse(view);
+        const bool occlusionOn = frustumCulling && occlusionCulling && !gpuCulling;
+        size_t bvhVisible = 0, occludedItems = 0;
+        if (gpuCulling) {
+            // 7) Kalıcı küme sadece bir model hazır olunca ya da GPU'dan
+            // düşünce, karo/dal tutamağı değişince güncellenir
+            const uint64_t version = Model::residencyVersion() + world.version() + bindVersion;
+            if (!residentValid || version != residentVersion) {
+                batch.updateResident([&](auto&& place) {
+                    for (uint32_t item = 0; item < actorItems(); ++item) {
+                        const SceneObject* obj = itemObject(item);
+                        place(item, residentModel(item), itemMatrix(item), obj ? obj->color : cityObj.color);
+                    }
+                });
+                perFrameItems.clear();
+                residentModels.clear();
+                unboundedResident.clear();
+                residentLo.clear();
+                residentHi.clear();
+                for (uint32_t item = 0; item < actorItems(); ++item) {
+                    const Model* model = residentModel(item);
+                    if (!model) {
+                        if (itemModel(item))
+                            perFrameItems.push_back(item);
+                        continue;
+                    }
+                    if (!model->hasBounds()) {
+                        unboundedResident.push_back(model);
+                        continue;
+                    }
+                    glm::vec3 lo, hi;
+                    FrustumCull::transformBox(itemMatrix(item), model->getBoundsMin(), model->getBoundsMax(),
+                        lo, hi);
+                    residentModels.push_back(model);
+                    residentLo.push_back(lo);
+                    residentHi.push_back(hi);
+                }
+                residentBvh.build(residentLo, residentHi);
+                residentVersion = version;
+                residentValid = true;
+            }
+            // Hangi yerleşimin çizildiğini GPU bilir; modeli bellekte tutmak
+            // için frustum'a değmesi yeter
+            if (frustumCulling) {
+                residentBvh.queryFrustum(FrustumCull::extractFrustum(proj * view), [&](uint32_t k) {
+                    residentModels[k]->touch();
+                });
+            }
+            else {
+                for (const Model* model : residentModels)
+                    model->touch();
+            }
+            for (const Model* model : unboundedResident)
+                model->touch();
+            for (uint32_t item : perFrameItems)
+                drawItem(item);
+            for (size_t i = 0; i < 3; ++i)
+                drawItem(uint32_t(actorItems() + i));
+        }
+        else {
+            residentValid = false;
+            // 7) Objeler, karolar ve aktörler: BVH frustum'a değenleri verir,
+            // meshleri ayrıca batch'te elenir
+            updateSceneBvh();
+            for (uint32_t item : unboundedItems)
+                drawItem(item);
+            frustumVisible.clear();
+            if (frustumCulling) {
+                sceneBvh.queryFrustum(FrustumCull::extractFrustum(proj * view), [&](uint32_t k) {
+                    frustumVisible.push_back(k);
+                });
+            }
+            else {
+                for (uint32_t k = 0; k < bvhItems.size(); ++k)
+                    frustumVisible.push_back(k);
+            }
+            if (occlusionOn) {
+                // Örtücüler yakından uzağa, üçgen bütçesi dolana kadar
+                occlusion.begin(proj * view);
+                occluderOrder.clear();
+                const glm::vec3 eyePos(eye[3]);
+                for (uint32_t k : frustumVisible) {
+                    const float d = glm::distance(eyePos, glm::clamp(eyePos, bvhLo[k], bvhHi[k]));
+                    if (d < occluderRange)
+                        occluderOrder.push_back({ d, k });
+                }
+                std::sort(occluderOrder.begin(), occluderOrder.end());
+                size_t triangles = 0;
+                for (const auto& o : occluderOrder) {
+                    const uint32_t item = bvhItems[o.second];
+                    const Model* model = itemModel(item);
+                    if (!model || !model->isReady() || model->getOccluder().empty())
+                        continue;
+                    triangles += model->getOccluder().size() / 3;
+                    if (triangles > occluderBudget)
+                        break;
+                    occlusion.addOccluder(model->getOccluder(), itemMatrix(item));
+                }
+                occlusion.rasterize();
+            }
+            bvhVisible = unboundedItems.size();
+            for (uint32_t k : frustumVisible) {
+                if (occlusionOn && !occlusion.visible(bvhLo[k], bvhHi[k])) {
+                    ++occludedItems;
+                    continue;
+                }
+                drawItem(bvhItems[k]);
+                ++bvhVisible;
+            }
+        }
+        batch.setOcclusion(occlusionOn ? &occlusion : nullptr);
+        if (printLookAt) {
+            if (gpuCulling)
+                updateSceneBvh();   // GPU culling karede BVH'yi güncellemez
+            // Işın sorgusu aynı BVH'den: göz noktasından bakış yönünde
+            const glm::vec3 origin(eye[3]), dir = -glm::vec3(eye[2]);
+            const glm::vec3 inv = 1.0f / dir;
+            float t = 1000.0f;
+            const int hit = sceneBvh.raycast(origin, dir, t, [&](uint32_t k, float& tMax) {
+                const float d = Bvh::Tree::rayBox(bvhLo[k], bvhHi[k], origin, inv, tMax);
+                if (d >= tMax)
+                    return false;
+                tMax = d;
+                return true;
+            });
+            if (hit < 0) {
+                std::cout << "Bakılan: hiçbir şey" << std::endl;
+            }
+            else {
+                const uint32_t item = bvhItems[size_t(hit)];
+                const SceneObject* obj = itemObject(item);
+                std::cout << "Bakılan: "
+                    << (obj ? obj->model->getPath() : "şehir karosu #" + std::to_string(item - tileItems))
+                    << " (" << t << " birim)" << std::endl;
+            }
+            printLookAt = false;
+        }
+        // Arena dışı meshler (glTF) tek tek, gerisi toplu
+        batch.flushLoose(uModelLoc, uColorLoc);
+        glUseProgram(batchProgram);
+        batch.flush();
+        const DrawBatch::Stats& ds = batch.getStats();
+        if (printDrawStats) {
+            if (gpuCulling) {
+                std::cout << "GPU culling" << (gpuCull.hasHiZ() ? " (Hi-Z ile)" : "") << ": "
+                    << batch.readGpuVisible() << "/" << ds.resident << " kalıcı yerleşim çizildi; her kare "
+                    << perFrameItems.size() + 3 << " obje, " << ds.visible << "/" << ds.added
+                    << " mesh görünür, " << ds.commands << " komut" << std::endl;
+            }
+            else {
+                std::cout << "Culling " << (frustumCulling ? "açık" : "kapalı") << ": " << bvhVisible << "/"
+                    << bvhItems.size() + unboundedItems.size() << " obje (BVH " << sceneBvh.nodeCount()
+                    << " düğüm), " << ds.visible << "/" << ds.added << " mesh görünür, " << ds.commands
+                    << " komut" << std::endl;
+                if (occlusionOn)
+                    std::cout << "Occlusion: " << occlusion.getStats().occluders << " örtücü, "
+                        << occlusion.getStats().triangles << " üçgen; " << occludedItems << " obje ve "
+                        << ds.occluded << " mesh gizli" << std::endl;
+                else
+                    std::cout << "Occlusion kapalı" << std::endl;
+            }
+            printDrawStats = false;
         }
 
+        // Bu karenin derinliği bir sonraki karenin Hi-Z testine
+        if (gpuCulling)
+            gpuCull.captureDepth(w, h, proj * view);
+        else
+            gpuCull.invalidate();
+
         // 9) Swap
         glfwSwapBuffers(window);
+
+        // Başlangıç gecikmesi: ilk kare ve tüm modellerin yüklendiği an
+        auto sinceStart = [&] {
+            return std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - appStart).count();
+        };
+        if (firstFrame) {
+            std::cout << "Time to first frame: " << sinceStart() << " ms" << std::endl;
+            firstFrame = false;
+        }
+        if (!fullFidelity) {
+            fullFidelity = loader.idle() && !world.building();
+            for (const auto* obj : { &carObj, &policeObj, &trainObj })
+                fullFidelity = fullFidelity && (!obj->model || obj->model->isReady() || obj->model->hasFailed());
+            for (const auto& obj : scene)
+                fullFidelity = fullFidelity && (!obj.model || obj.model->isReady() || obj.model->hasFailed());
+            if (fullFidelity) {
+                std::cout << "Time to full fidelity: " << sinceStart() << " ms" << std::endl;
+                if (progressive) {
+                    std::cout << "Model yükleme:\n";
+                    models.printStats(std::cout);
+                }
+                std::cout << "Şehir karoları: " << world.residentCount() << "/" << world.tileCount()
+                    << " yüklü, " << world.residentBytes() / (1024 * 1024) << " MB" << std::endl;
+                std::cout << "Çizim: " << ds.visible << "/" << ds.added << " görünür, " << ds.draws << " mesh, " << ds.commands << " instanced komut, "
+                    << ds.multiDraws << " glMultiDrawElementsIndirect ile, " << ds.loose << " tek tek, "
+                    << ds.occluded << " örtülü" << std::endl;
+            }
+        }
     }
+    // GL kaynakları context kapanmadan serbest bırakılmalı
+    animations.clear();
+    scene.clear();
+    world.clear();
+    carObj.model.reset();
+    policeObj.model.reset();
+    trainObj.model.reset();
+    prefetch.clear();
+    sceneModels.clear();
+    proxyBox.reset();
+    batch.release();
+    gpuCull.release();
+    MeshArena::shutdown();
+    uploadRing.shutdown();
     glfwTerminate();
     return 0;
 }